@@ -0,0 +1,141 @@
+#include "async_log_writer.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+AsyncLogWriter::AsyncLogWriter(std::unique_ptr<LogSink> sink, const std::string& source,
+                               std::size_t capacity)
+    : sink_(std::move(sink))
+    , ring_(capacity)
+    , source_(source)
+{
+    thread_ = std::thread(&AsyncLogWriter::Run, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogWriter::SetSource(const std::string& source)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    source_ = source;
+    reopen_ = true;
+}
+
+void AsyncLogWriter::Write(WORD type, const std::string& text)
+{
+    Push(type, text.data(), text.size());
+}
+
+void AsyncLogWriter::Write(WORD type, const LogRecord& record)
+{
+    Push(static_cast<uint16_t>(type | kRecord), record.Data(), record.Size());
+}
+
+void AsyncLogWriter::Push(uint16_t tag, const char* data, std::size_t size)
+{
+    if (!ring_.TryPush(tag, EventRing::Clock::time_point(), data, size))
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // either the worker sees the line in Size() before going to sleep or
+    // this sees it asleep, and only the first writer to see it wakes it
+    if (!sleeping_.load(std::memory_order_seq_cst) || !sleeping_.exchange(false, std::memory_order_seq_cst))
+        return;
+    {
+        // it's in wait() once the lock is free
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    cv_.notify_one();
+}
+
+bool AsyncLogWriter::Flush(std::chrono::milliseconds timeout)
+{
+    const uint64_t target = ring_.Pushed();
+    std::unique_lock<std::mutex> lock(mutex_);
+    return flushed_cv_.wait_for(lock, timeout, [&] { return written_ >= target; });
+}
+
+uint64_t AsyncLogWriter::Dropped() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void AsyncLogWriter::Run()
+{
+#ifndef _WIN32
+    // signals belong to the service's signal loop
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, nullptr);
+#endif
+
+    // the lines keep their buffers between batches
+    std::vector<LogSink::Line> batch;
+    uint64_t reported_dropped = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        // re-armed after every wakeup, Write() disarms it when it notifies
+        while (true)
+        {
+            sleeping_.store(true, std::memory_order_seq_cst);
+            if (stop_ || ring_.Size() != 0)
+                break;
+            cv_.wait(lock);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+        if (ring_.Size() == 0)
+            break;
+
+        const bool reopen = reopen_;
+        reopen_ = false;
+        const std::string source = reopen ? source_ : std::string();
+        lock.unlock();
+
+        std::size_t count = 0;
+        ring_.Drain(ring_.Capacity(), [&](const EventRing::Event& event) {
+            if (count == batch.size())
+                batch.emplace_back();
+            LogSink::Line& line = batch[count];
+            line.type = static_cast<WORD>(event.level & ~kRecord);
+            if (event.level & kRecord)
+            {
+                line.text.clear();
+                LogRecord::Render(line.text, event.text, event.size);
+            }
+            else
+                line.text.assign(event.text, event.size);
+            ++count;
+        });
+        if (count == 0)
+        {
+            // claimed but still being copied in
+            std::this_thread::yield();
+        }
+        if (reopen)
+            sink_->Open(source);
+        sink_->Write(batch.data(), count);
+        const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped)
+        {
+            LogSink::Line line{ EVENTLOG_WARNING_TYPE,
+                std::to_string(dropped - reported_dropped) + " log messages dropped, queue full" };
+            sink_->Write(&line, 1);
+            reported_dropped = dropped;
+        }
+
+        lock.lock();
+        written_ = ring_.Popped();
+        flushed_cv_.notify_all();
+    }
+}
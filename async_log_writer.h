@@ -0,0 +1,74 @@
+#ifndef ASYNC_LOG_WRITER_H
+#define ASYNC_LOG_WRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_ring.h"
+#include "log_record.h"
+#include "log_sink.h"
+
+// Moves log writes off the calling thread. Write() puts lines into a
+// lock-free ring and a background thread hands everything queued since its
+// last pass to the sink as one batch, rendering LogRecords to text on the
+// way. The ring is bounded, lines that don't fit are counted and reported
+// once there is room again.
+class AsyncLogWriter
+{
+public:
+    AsyncLogWriter(std::unique_ptr<LogSink> sink, const std::string& source,
+                   std::size_t capacity = 4096);
+    // Writes what is still queued.
+    ~AsyncLogWriter();
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    // The sink is reopened under the new name before the next batch.
+    void SetSource(const std::string& source);
+
+    // Never waits for the sink or for other writers.
+    void Write(WORD type, const std::string& text);
+    void Write(WORD type, const LogRecord& record);
+
+    // Waits until every line queued so far was written, false on timeout.
+    bool Flush(std::chrono::milliseconds timeout);
+
+    uint64_t Dropped() const;
+
+private:
+    void Push(uint16_t tag, const char* data, std::size_t size);
+    void Run();
+
+    // Set in the tag of ring entries holding a LogRecord, the type fills the
+    // low bits.
+    static const uint16_t kRecord = 0x8000;
+
+    std::unique_ptr<LogSink> sink_;
+    // The sinks stamp lines themselves, the event times are left empty.
+    EventRing ring_;
+    // Set while the worker waits for lines, Write() only wakes it then.
+    // The first writer to find it set clears it.
+    std::atomic<bool> sleeping_{ false };
+    std::atomic<uint64_t> dropped_{ 0 };
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    // Lines taken from the ring and written out, for Flush().
+    uint64_t written_ = 0;
+    std::string source_;
+    bool reopen_ = true;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#endif
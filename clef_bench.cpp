@@ -0,0 +1,107 @@
+// Times serializing log events for Seq: ClefWriter appending into a reused
+// buffer against building the event as a json DOM and dump()ing it, which
+// is what UpdaterService::Log() did before. Heap allocations are counted
+// through a replaced global operator new.
+//
+//   clef_bench [events]
+
+#include "clef_writer.h"
+#include "log_record.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "json.hpp"
+
+namespace
+{
+    // Single threaded, the benchmark allocates from main() only.
+    std::size_t g_allocations = 0;
+
+    const char kTemplate[] = "(windows_updater: {machine_name}) {msg}";
+    const char kMachine[] = "BUILD-AGENT-07";
+    const char kTimestamp[] = "2024-01-01T00:00:00.000000Z";
+
+    // The event the service built per Log() call, minus the send.
+    std::size_t serialize_with_dom(std::string& out, const std::string& message)
+    {
+        using nlohmann::json;
+        json body;
+        body["Level"] = "Error";
+        body["Timestamp"] = kTimestamp;
+        body["MessageTemplate"] = kTemplate;
+        json prop;
+        prop["machine_name"] = kMachine;
+        prop["msg"] = message;
+        body["Properties"] = prop;
+        json wrapper;
+        wrapper["Events"] = json::array({ body });
+        out = wrapper.dump(-1, ' ', true);
+        return out.size();
+    }
+
+    template <typename Serialize>
+    void run(const char* name, std::size_t events, Serialize serialize)
+    {
+        std::size_t bytes = 0;
+        // warms up the buffers that are reused
+        serialize();
+        const std::size_t allocations = g_allocations;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < events; ++i)
+            bytes += serialize();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::printf("  %-22s %10.0f events/s  %6.2f allocations/event  %zu bytes/event\n", name,
+                    events / elapsed.count(), static_cast<double>(g_allocations - allocations) / events,
+                    bytes / events);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t events = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::string job = "miner";
+    const unsigned long error = 1326;
+    const std::string message = job + ": error while launching updater: " + std::to_string(error);
+
+    ClefWriter writer;
+    writer.Init(kTemplate, kMachine);
+    std::string out;
+
+    std::printf("%zu events\n", events);
+    run("json + dump()", events / 10, [&] { return serialize_with_dom(out, message); });
+    run("ClefWriter, {msg}", events, [&] {
+        out.clear();
+        const LogRecord record("{msg}", message);
+        writer.Append(out, ClefWriter::Level::Error, kTimestamp, sizeof kTimestamp - 1, record.Data(), record.Size());
+        return out.size();
+    });
+    run("ClefWriter, record", events, [&] {
+        out.clear();
+        const LogRecord record("{job}: error while launching updater: {error}", job, error);
+        writer.Append(out, ClefWriter::Level::Error, kTimestamp, sizeof kTimestamp - 1, record.Data(), record.Size());
+        return out.size();
+    });
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "clef_writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    const char* const kLevelNames[] = { "Debug", "Information", "Warning", "Error" };
+    const char kMessageKey[] = "{msg}";
+    const char kTimestampKey[] = "},\"Timestamp\":\"";
+    const char kTail[] = "\"}";
+    const char kRepeatCountKey[] = ",\"RepeatCount\":";
+    const char kFirstTimestampKey[] = ",\"FirstTimestamp\":\"";
+    const char kLastTimestampKey[] = "\",\"LastTimestamp\":\"";
+    const char kReplacement[] = "\\ufffd";
+    const char kHex[] = "0123456789abcdef";
+
+    // Length of the UTF-8 sequence starting at |p| or 0 if it's invalid.
+    std::size_t utf8_sequence(const unsigned char* p, std::size_t left)
+    {
+        std::size_t len;
+        unsigned min;
+        unsigned cp;
+        if (p[0] >= 0xC2 && p[0] <= 0xDF)
+        {
+            len = 2; min = 0x80; cp = p[0] & 0x1F;
+        }
+        else if ((p[0] & 0xF0) == 0xE0)
+        {
+            len = 3; min = 0x800; cp = p[0] & 0x0F;
+        }
+        else if (p[0] >= 0xF0 && p[0] <= 0xF4)
+        {
+            len = 4; min = 0x10000; cp = p[0] & 0x07;
+        }
+        else
+            return 0;
+
+        if (left < len)
+            return 0;
+        for (std::size_t i = 1; i < len; ++i)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+                return 0;
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            return 0;
+        return len;
+    }
+}
+
+void ClefWriter::Init(const std::string& message_template, const std::string& machine_name)
+{
+    // the record's template goes in place of {msg}
+    std::size_t message = message_template.find(kMessageKey);
+    std::size_t rest = message + sizeof kMessageKey - 1;
+    if (message == std::string::npos)
+        message = rest = message_template.size();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Level::Count); ++i)
+    {
+        std::string& head = head_[i];
+        head.clear();
+        head += "{\"Level\":\"";
+        head += kLevelNames[i];
+        head += "\",\"MessageTemplate\":\"";
+        AppendEscaped(head, message_template.data(), message);
+    }
+    properties_.clear();
+    AppendEscaped(properties_, message_template.data() + rest, message_template.size() - rest);
+    properties_ += "\",\"Properties\":{\"machine_name\":\"";
+    AppendEscaped(properties_, machine_name.data(), machine_name.size());
+    properties_ += '"';
+}
+
+void ClefWriter::Append(std::string& out, Level level, const char* timestamp, std::size_t timestamp_size,
+                        const char* record, std::size_t record_size) const
+{
+    AppendEvent(out, level, record, record_size);
+    out.append(kTimestampKey, sizeof kTimestampKey - 1);
+    AppendEscaped(out, timestamp, timestamp_size);
+    out.append(kTail, sizeof kTail - 1);
+}
+
+void ClefWriter::AppendRepeats(std::string& out, Level level, const char* record, std::size_t record_size,
+                               uint64_t repeat_count, const char* first, const char* last,
+                               std::size_t timestamp_size) const
+{
+    AppendEvent(out, level, record, record_size);
+    out.append(kRepeatCountKey, sizeof kRepeatCountKey - 1);
+    out += std::to_string(repeat_count);
+    out.append(kFirstTimestampKey, sizeof kFirstTimestampKey - 1);
+    AppendEscaped(out, first, timestamp_size);
+    out.append(kLastTimestampKey, sizeof kLastTimestampKey - 1);
+    AppendEscaped(out, last, timestamp_size);
+    out += '"';
+    out.append(kTimestampKey, sizeof kTimestampKey - 1);
+    AppendEscaped(out, last, timestamp_size);
+    out.append(kTail, sizeof kTail - 1);
+}
+
+void ClefWriter::AppendEvent(std::string& out, Level level, const char* record, std::size_t record_size) const
+{
+    LogRecord::Reader reader(record, record_size);
+    const char* at = reader.Template();
+    const char* end = at + std::strlen(at);
+    out += head_[static_cast<std::size_t>(level)];
+    AppendEscaped(out, at, static_cast<std::size_t>(end - at));
+    out += properties_;
+
+    LogRecord::Hole hole;
+    LogRecord::Value value;
+    for (std::size_t i = 0; reader.Next(value); ++i)
+    {
+        out += ",\"";
+        if (LogRecord::FindHole(at, end, hole))
+        {
+            AppendEscaped(out, hole.name, hole.name_size);
+            at = hole.end;
+        }
+        else
+        {
+            out += "__";
+            out += std::to_string(i);
+        }
+        out += "\":";
+        AppendValue(out, value);
+    }
+}
+
+//static
+void ClefWriter::AppendValue(std::string& out, const LogRecord::Value& value)
+{
+    char number[32];
+    int size = 0;
+    switch (value.type)
+    {
+    case LogRecord::Type::Bool:
+        out += value.boolean ? "true" : "false";
+        return;
+    case LogRecord::Type::Int:
+        size = std::snprintf(number, sizeof number, "%lld", static_cast<long long>(value.integer));
+        break;
+    case LogRecord::Type::UInt:
+        size = std::snprintf(number, sizeof number, "%llu", static_cast<unsigned long long>(value.unsigned_integer));
+        break;
+    case LogRecord::Type::Double:
+        // JSON has no NaN or infinity
+        if (!std::isfinite(value.number))
+        {
+            out += "null";
+            return;
+        }
+        size = std::snprintf(number, sizeof number, "%.17g", value.number);
+        break;
+    case LogRecord::Type::String:
+        out += '"';
+        AppendEscaped(out, value.text, value.size);
+        out += '"';
+        return;
+    }
+    out.append(number, static_cast<std::size_t>(size));
+}
+
+//static
+void ClefWriter::AppendEscaped(std::string& out, const char* data, std::size_t size)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    std::size_t run = 0;
+    std::size_t i = 0;
+    while (i < size)
+    {
+        const unsigned char c = p[i];
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+        {
+            ++i;
+            continue;
+        }
+
+        if (c >= 0x80)
+        {
+            const std::size_t len = utf8_sequence(p + i, size - i);
+            if (len != 0)
+            {
+                i += len;
+                continue;
+            }
+        }
+
+        // flush the plain run before the byte that needs escaping
+        out.append(data + run, i - run);
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (c < 0x20)
+            {
+                const char esc[] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF] };
+                out.append(esc, sizeof esc);
+            }
+            else
+                out.append(kReplacement, sizeof kReplacement - 1);
+            break;
+        }
+        ++i;
+        run = i;
+    }
+    out.append(data + run, size - run);
+}
@@ -0,0 +1,58 @@
+#ifndef CLEF_WRITER_H
+#define CLEF_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "log_record.h"
+
+// Serializes Seq raw events without building a JSON document.
+// Events come as LogRecords, their template is put in place of {msg} in the
+// service's message template and each value becomes a property of its own,
+// typed as it was captured. The constant parts of the event are rendered
+// once by Init(), each event is a few appends plus escaping.
+class ClefWriter
+{
+public:
+    enum class Level
+    {
+        Debug,
+        Information,
+        Warning,
+        Error,
+        Count
+    };
+
+    ClefWriter() = default;
+
+    // |message_template| must reference {machine_name} and {msg}.
+    void Init(const std::string& message_template, const std::string& machine_name);
+
+    // Appends the event of an encoded LogRecord to |out|. Values without a
+    // hole in the template are named __0, __1 and so on by position.
+    // Doesn't allocate once |out| has grown to fit an event.
+    void Append(std::string& out, Level level, const char* timestamp, std::size_t timestamp_size,
+                const char* record, std::size_t record_size) const;
+
+    // Appends one event standing for |repeat_count| repeats of |record|,
+    // with RepeatCount, FirstTimestamp and LastTimestamp properties. It's
+    // stamped with the last one.
+    void AppendRepeats(std::string& out, Level level, const char* record, std::size_t record_size,
+                       uint64_t repeat_count, const char* first, const char* last, std::size_t timestamp_size) const;
+
+    // Appends |data| as the contents of a JSON string. Invalid UTF-8 is
+    // replaced with U+FFFD so the event always stays valid JSON.
+    static void AppendEscaped(std::string& out, const char* data, std::size_t size);
+
+private:
+    // Everything up to the end of the last property.
+    void AppendEvent(std::string& out, Level level, const char* record, std::size_t record_size) const;
+    static void AppendValue(std::string& out, const LogRecord::Value& value);
+
+    // Up to the record's template, and from there to the first property.
+    std::string head_[static_cast<std::size_t>(Level::Count)];
+    std::string properties_;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "command_line.h"
+
+CommandLine::CommandLine(std::vector<std::string> args)
+    : args_(std::move(args))
+{
+    Build();
+}
+
+CommandLine::CommandLine(const CommandLine& other)
+    : args_(other.args_)
+{
+    Build();
+}
+
+CommandLine& CommandLine::operator=(const CommandLine& other)
+{
+    if (this != &other)
+    {
+        args_ = other.args_;
+        Build();
+    }
+    return *this;
+}
+
+std::string CommandLine::ToString() const
+{
+    std::string text;
+    for (const auto& arg : args_)
+    {
+        if (!text.empty())
+            text += ' ';
+        if (!arg.empty() && arg.find_first_of(" \t\"'") == std::string::npos)
+        {
+            text += arg;
+            continue;
+        }
+        text += '"';
+        for (char c : arg)
+        {
+            if (c == '"')
+                text += '\\';
+            text += c;
+        }
+        text += '"';
+    }
+    return text;
+}
+
+void CommandLine::Build()
+{
+    argv_.clear();
+    argv_.reserve(args_.size() + 1);
+    for (const auto& arg : args_)
+        argv_.push_back(arg.c_str());
+    argv_.push_back(nullptr);
+}
+
+bool split_arguments(const std::string& text, std::vector<std::string>& args, std::string& error)
+{
+    std::string arg;
+    // an argument can be empty if it was quoted
+    bool in_arg = false;
+    char quote = 0;
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        const char c = text[i];
+        if (c == '\\' && i + 1 < text.size() && (text[i + 1] == '"' || text[i + 1] == '\''))
+        {
+            arg += text[++i];
+            in_arg = true;
+        }
+        else if (quote)
+        {
+            if (c == quote)
+                quote = 0;
+            else
+                arg += c;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            quote = c;
+            in_arg = true;
+        }
+        else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            if (in_arg)
+                args.push_back(std::move(arg));
+            arg.clear();
+            in_arg = false;
+        }
+        else
+        {
+            arg += c;
+            in_arg = true;
+        }
+    }
+
+    if (quote)
+    {
+        error = std::string("unterminated ") + (quote == '"' ? "double" : "single") + " quote";
+        return false;
+    }
+    if (in_arg)
+        args.push_back(std::move(arg));
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <string>
+#include <vector>
+
+// Program and arguments with the null terminated argv the process API wants
+// built once, so starting the program doesn't allocate.
+class CommandLine
+{
+public:
+    CommandLine() = default;
+    explicit CommandLine(std::vector<std::string> args);
+
+    // Moving keeps the string buffers and so the pointers into them, a copy
+    // has to point at its own strings.
+    CommandLine(const CommandLine& other);
+    CommandLine& operator=(const CommandLine& other);
+    CommandLine(CommandLine&&) noexcept = default;
+    CommandLine& operator=(CommandLine&&) noexcept = default;
+
+    bool Empty() const { return args_.empty(); }
+    int Argc() const { return static_cast<int>(args_.size()); }
+    // Ends with a null pointer that Argc() doesn't count.
+    const char* const* Argv() const { return argv_.data(); }
+    const std::vector<std::string>& Args() const { return args_; }
+
+    // For logs, arguments with spaces or quotes are quoted.
+    std::string ToString() const;
+
+private:
+    void Build();
+
+    std::vector<std::string> args_;
+    std::vector<const char*> argv_{ nullptr };
+};
+
+// Splits |text| into arguments at whitespace. Double or single quotes group
+// words into one argument ("" gives an empty one) and a backslash in front
+// of a quote makes it literal. Other backslashes are kept as they are so
+// Windows paths need no escaping. Returns false with a description in
+// |error| on an unterminated quote.
+bool split_arguments(const std::string& text, std::vector<std::string>& args, std::string& error);
+
+#endif
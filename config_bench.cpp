@@ -0,0 +1,119 @@
+// Times loading a config_updater.json with many jobs: the streaming binder
+// in updater_config.cpp against parsing into a json DOM first and reading
+// the fields from it, which is what the service used to do.
+//
+//   config_bench [jobs] [rounds]
+
+#include "updater_config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "json.hpp"
+
+namespace
+{
+    std::string make_config(std::size_t jobs)
+    {
+        std::string text = "{\"name\":\"Bench\",\"max_concurrent_jobs\":4,\"log_server\":\"http://localhost:5341\",\"jobs\":[";
+        for (std::size_t i = 0; i < jobs; ++i)
+        {
+            if (i != 0)
+                text += ',';
+            text += "\n{\"name\":\"job" + std::to_string(i) + "\",\"updater\":\"C:\\\\updaters\\\\updater"
+                + std::to_string(i) + ".exe\",\"args\":\"-f ftp://10.7.5.32/distro/feed" + std::to_string(i)
+                + ".xml -c read-ftp:secret\",\"interval\":300,\"splay\":300,\"jitter\":30,"
+                  "\"max_backoff\":3600,\"after_update_interval\":60}";
+        }
+        text += "]}";
+        return text;
+    }
+
+    // The field by field DOM reads the loader did before.
+    bool load_with_dom(const std::string& path, UpdaterConfig& config)
+    {
+        using nlohmann::json;
+        std::ifstream file(path);
+        json options;
+        try
+        {
+            file >> options;
+            config.name = options["name"].get<std::string>();
+            config.jobs.clear();
+            for (auto& entry : options["jobs"])
+            {
+                JobConfig job;
+                job.name = entry.value("name", "job" + std::to_string(config.jobs.size()));
+                job.updater_filepath = entry["updater"].get<std::string>();
+                std::string error;
+                if (!split_arguments(entry["args"].get<std::string>(), job.updater_arguments, error))
+                    return false;
+                job.schedule.interval = std::chrono::seconds{ entry["interval"].get<unsigned long>() };
+                job.schedule.splay = std::chrono::seconds{ entry.value("splay", 0ul) };
+                job.schedule.jitter = std::chrono::seconds{ entry.value("jitter", 0ul) };
+                job.schedule.max_backoff = std::chrono::seconds{ entry.value("max_backoff", 0ul) };
+                job.schedule.after_update = std::chrono::seconds{ entry.value("after_update_interval", 0ul) };
+                job.BuildCommands();
+                config.jobs.push_back(std::move(job));
+            }
+            config.max_concurrent_jobs = options["max_concurrent_jobs"].get<std::size_t>();
+            config.log_server = options["log_server"].get<std::string>();
+        }
+        catch (json::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename Load>
+    double best_of(int rounds, Load load)
+    {
+        double best = 0;
+        for (int i = 0; i < rounds; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            if (!load())
+            {
+                std::fprintf(stderr, "load failed\n");
+                std::exit(1);
+            }
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (i == 0 || elapsed.count() < best)
+                best = elapsed.count();
+        }
+        return best;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t jobs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    const std::string path = "config_bench.json";
+    const std::string text = make_config(jobs);
+    std::ofstream(path, std::ios::binary) << text;
+
+    const double binder = best_of(rounds, [&]
+    {
+        UpdaterConfig config;
+        std::string error;
+        std::vector<std::string> warnings;
+        return load_updater_config(path, config, error, warnings) && config.jobs.size() == jobs;
+    });
+    const double dom = best_of(rounds, [&]
+    {
+        UpdaterConfig config;
+        return load_with_dom(path, config) && config.jobs.size() == jobs;
+    });
+
+    std::printf("%zu jobs, %zu bytes, best of %d\n", jobs, text.size(), rounds);
+    std::printf("  binder: %8.2f ms\n", binder);
+    std::printf("  dom:    %8.2f ms\n", dom);
+    std::remove(path.c_str());
+    return 0;
+}
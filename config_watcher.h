@@ -0,0 +1,58 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <functional>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <atomic>
+#endif
+
+// Calls back on its own thread when a file changes.
+// The directory holding the file is watched rather than the file itself
+// (inotify on Linux, ReadDirectoryChangesW on Windows) so editors that save
+// by writing a temporary file and renaming it over the original are seen
+// too. A burst of changes results in one callback once the file has been
+// left alone for a moment.
+class ConfigWatcher
+{
+public:
+    using Callback = std::function<void()>;
+
+    ConfigWatcher() = default;
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    // Returns false if |path| can't be watched, nothing runs then.
+    bool Start(const std::string& path, Callback callback);
+    void Stop();
+
+    // Runs the callback on the watcher thread as if the file changed.
+    // Returns false if the watcher isn't running.
+    bool Trigger();
+
+private:
+    void Run();
+
+    std::string filename_;
+    Callback callback_;
+    std::thread thread_;
+
+#ifdef _WIN32
+    HANDLE directory_ = INVALID_HANDLE_VALUE;
+    HANDLE trigger_ = nullptr;
+    HANDLE stop_ = nullptr;
+#else
+    int inotify_fd_ = -1;
+    // Wakes the thread for Trigger() and Stop().
+    int event_fd_ = -1;
+    std::atomic<bool> stop_{ false };
+#endif
+};
+
+#endif
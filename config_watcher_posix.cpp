@@ -0,0 +1,131 @@
+#include "config_watcher.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <experimental/filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace
+{
+    // Quiet time after the last change before the callback runs.
+    const int kSettleMs = 250;
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    Stop();
+}
+
+bool ConfigWatcher::Start(const std::string& path, Callback callback)
+{
+    namespace fs = std::experimental::filesystem;
+    if (thread_.joinable())
+        return false;
+
+    const fs::path file{ path };
+    std::string directory = file.parent_path().string();
+    if (directory.empty())
+        directory = ".";
+    filename_ = file.filename().string();
+    callback_ = std::move(callback);
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // IN_CLOSE_WRITE for editors writing in place, IN_MOVED_TO for those
+    // renaming a new file over the old one
+    if (inotify_fd_ == -1 || event_fd_ == -1
+        || inotify_add_watch(inotify_fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+    {
+        const int error = errno;
+        Stop();
+        errno = error;
+        return false;
+    }
+
+    stop_ = false;
+    thread_ = std::thread(&ConfigWatcher::Run, this);
+    return true;
+}
+
+void ConfigWatcher::Stop()
+{
+    if (thread_.joinable())
+    {
+        stop_ = true;
+        const uint64_t one = 1;
+        (void)write(event_fd_, &one, sizeof one);
+        thread_.join();
+    }
+    if (inotify_fd_ != -1)
+    {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    if (event_fd_ != -1)
+    {
+        close(event_fd_);
+        event_fd_ = -1;
+    }
+}
+
+bool ConfigWatcher::Trigger()
+{
+    if (!thread_.joinable())
+        return false;
+    const uint64_t one = 1;
+    return write(event_fd_, &one, sizeof one) == sizeof one;
+}
+
+void ConfigWatcher::Run()
+{
+    // inotify needs room for at least one event with the longest name
+    alignas(inotify_event) char buffer[4096];
+    bool pending = false;
+    while (true)
+    {
+        pollfd fds[] = { { inotify_fd_, POLLIN, 0 }, { event_fd_, POLLIN, 0 } };
+        const int ready = poll(fds, 2, pending ? kSettleMs : -1);
+        if (ready == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (stop_)
+            return;
+
+        if (ready == 0)
+        {
+            // nothing happened for the settle time, the writer is done
+            pending = false;
+            callback_();
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            uint64_t count;
+            if (read(event_fd_, &count, sizeof count) == sizeof count)
+                callback_();
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t size;
+            while ((size = read(inotify_fd_, buffer, sizeof buffer)) > 0)
+            {
+                for (char* p = buffer; p < buffer + size;)
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                    if ((event->mask & IN_Q_OVERFLOW) || (event->len != 0 && filename_ == event->name))
+                        pending = true;
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+    }
+}
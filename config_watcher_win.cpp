@@ -0,0 +1,148 @@
+#include "config_watcher.h"
+
+#include <experimental/filesystem>
+#include <vector>
+
+namespace
+{
+    // Quiet time after the last change before the callback runs.
+    const DWORD kSettleMs = 250;
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    Stop();
+}
+
+bool ConfigWatcher::Start(const std::string& path, Callback callback)
+{
+    namespace fs = std::experimental::filesystem;
+    if (thread_.joinable())
+        return false;
+
+    const fs::path file{ path };
+    std::string directory = file.parent_path().string();
+    if (directory.empty())
+        directory = ".";
+    filename_ = file.filename().string();
+    callback_ = std::move(callback);
+
+    directory_ = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                             FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    trigger_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    stop_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (directory_ == INVALID_HANDLE_VALUE || !trigger_ || !stop_)
+    {
+        const DWORD error = GetLastError();
+        Stop();
+        SetLastError(error);
+        return false;
+    }
+
+    thread_ = std::thread(&ConfigWatcher::Run, this);
+    return true;
+}
+
+void ConfigWatcher::Stop()
+{
+    if (thread_.joinable())
+    {
+        SetEvent(stop_);
+        thread_.join();
+    }
+    if (directory_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(directory_);
+        directory_ = INVALID_HANDLE_VALUE;
+    }
+    if (trigger_)
+    {
+        CloseHandle(trigger_);
+        trigger_ = nullptr;
+    }
+    if (stop_)
+    {
+        CloseHandle(stop_);
+        stop_ = nullptr;
+    }
+}
+
+bool ConfigWatcher::Trigger()
+{
+    return thread_.joinable() && SetEvent(trigger_);
+}
+
+void ConfigWatcher::Run()
+{
+    // notification names are UTF-16 and compared case insensitively
+    const int length = MultiByteToWideChar(CP_ACP, 0, filename_.c_str(), -1, nullptr, 0);
+    std::vector<WCHAR> filename(length > 0 ? length : 1);
+    MultiByteToWideChar(CP_ACP, 0, filename_.c_str(), -1, filename.data(), length);
+
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent)
+        return;
+
+    // FILE_NOTIFY_INFORMATION records need DWORD alignment
+    alignas(DWORD) char buffer[16 * 1024];
+    const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+    bool watching = false;
+    bool pending = false;
+    while (true)
+    {
+        if (!watching)
+        {
+            ResetEvent(overlapped.hEvent);
+            watching = ReadDirectoryChangesW(directory_, buffer, sizeof buffer, FALSE, filter,
+                                             nullptr, &overlapped, nullptr) != FALSE;
+        }
+
+        HANDLE events[] = { stop_, trigger_, overlapped.hEvent };
+        const DWORD count = watching ? 3 : 2;
+        const DWORD result = WaitForMultipleObjects(count, events, FALSE, pending ? kSettleMs : INFINITE);
+        if (result == WAIT_OBJECT_0 || result == WAIT_FAILED)
+            break;
+
+        if (result == WAIT_TIMEOUT)
+        {
+            // nothing happened for the settle time, the writer is done
+            pending = false;
+            callback_();
+        }
+        else if (result == WAIT_OBJECT_0 + 1)
+        {
+            callback_();
+        }
+        else
+        {
+            watching = false;
+            DWORD size = 0;
+            if (!GetOverlappedResult(directory_, &overlapped, &size, FALSE))
+                continue;
+            // zero means the buffer overflowed and the changes were lost
+            if (size == 0)
+                pending = true;
+            for (DWORD offset = 0; size != 0;)
+            {
+                const FILE_NOTIFY_INFORMATION* info
+                    = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+                if (CompareStringOrdinal(info->FileName, static_cast<int>(info->FileNameLength / sizeof(WCHAR)),
+                                         filename.data(), length - 1, TRUE) == CSTR_EQUAL)
+                    pending = true;
+                if (info->NextEntryOffset == 0)
+                    break;
+                offset += info->NextEntryOffset;
+            }
+        }
+    }
+
+    if (watching)
+    {
+        CancelIo(directory_);
+        DWORD size;
+        GetOverlappedResult(directory_, &overlapped, &size, TRUE);
+    }
+    CloseHandle(overlapped.hEvent);
+}
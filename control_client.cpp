@@ -0,0 +1,207 @@
+// service_ctl: sends one command over the local control channel of a
+// running service and prints the reply.
+//
+//   service_ctl <service name|socket path> <command> [argument]
+//
+// Exits with 0 if the service carried out the command.
+
+#include "control_protocol.h"
+
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // How long to wait for a free pipe instance on Windows.
+    const unsigned kConnectTimeoutMs = 5000;
+
+#ifdef _WIN32
+    using Connection = HANDLE;
+    const Connection kInvalidConnection = INVALID_HANDLE_VALUE;
+
+    Connection connect_endpoint(const std::string& endpoint)
+    {
+        while (true)
+        {
+            HANDLE pipe = CreateFileA(endpoint.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                      OPEN_EXISTING, 0, nullptr);
+            if (pipe != INVALID_HANDLE_VALUE)
+                return pipe;
+            // every instance is serving someone, wait for one to free up
+            if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(endpoint.c_str(), kConnectTimeoutMs))
+                return INVALID_HANDLE_VALUE;
+        }
+    }
+
+    bool send_all(Connection connection, const std::string& data)
+    {
+        DWORD written = 0;
+        return WriteFile(connection, data.data(), static_cast<DWORD>(data.size()), &written, nullptr)
+            && written == data.size();
+    }
+
+    long receive(Connection connection, char* buffer, std::size_t size)
+    {
+        DWORD read = 0;
+        if (!ReadFile(connection, buffer, static_cast<DWORD>(size), &read, nullptr))
+            return -1;
+        return static_cast<long>(read);
+    }
+
+    void disconnect(Connection connection)
+    {
+        CloseHandle(connection);
+    }
+
+    int last_error()
+    {
+        return static_cast<int>(GetLastError());
+    }
+#else
+    using Connection = int;
+    const Connection kInvalidConnection = -1;
+
+    Connection connect_endpoint(const std::string& endpoint)
+    {
+        sockaddr_un address{};
+        if (endpoint.size() >= sizeof address.sun_path)
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            return -1;
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) == -1)
+        {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        return fd;
+    }
+
+    bool send_all(Connection connection, const std::string& data)
+    {
+        std::size_t sent = 0;
+        while (sent < data.size())
+        {
+            const ssize_t size = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (size == -1 && errno == EINTR)
+                continue;
+            if (size <= 0)
+                return false;
+            sent += static_cast<std::size_t>(size);
+        }
+        return true;
+    }
+
+    long receive(Connection connection, char* buffer, std::size_t size)
+    {
+        while (true)
+        {
+            const ssize_t read_size = read(connection, buffer, size);
+            if (read_size == -1 && errno == EINTR)
+                continue;
+            return static_cast<long>(read_size);
+        }
+    }
+
+    void disconnect(Connection connection)
+    {
+        close(connection);
+    }
+
+    int last_error()
+    {
+        return errno;
+    }
+#endif
+
+    void print_usage(const char* program)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s <service name|socket path> <command> [argument]\n"
+                     "Commands: status, run-now <job>, reload-config, stats, flush-logs\n",
+                     program);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3 || argc > 4)
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    ControlRequest request;
+    if (!parse_control_command(argv[2], request.command))
+    {
+        std::fprintf(stderr, "Unknown command: %s\n", argv[2]);
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (argc == 4)
+        request.argument = argv[3];
+
+    // a path is taken as is, e.g. the socket in the RuntimeDirectory= of a
+    // systemd unit
+    const std::string target{ argv[1] };
+    const std::string endpoint = target.find_first_of("/\\") != std::string::npos ? target : control_endpoint(target);
+
+    const Connection connection = connect_endpoint(endpoint);
+    if (connection == kInvalidConnection)
+    {
+        std::fprintf(stderr, "Cannot connect to %s: %d\n", endpoint.c_str(), last_error());
+        return 1;
+    }
+
+    std::string out;
+    append_frame(out, encode_request(request));
+    if (!send_all(connection, out))
+    {
+        std::fprintf(stderr, "Cannot send the request: %d\n", last_error());
+        disconnect(connection);
+        return 1;
+    }
+
+    std::string in;
+    std::string payload;
+    char buffer[4096];
+    int result;
+    while ((result = take_frame(in, payload)) == 0)
+    {
+        const long size = receive(connection, buffer, sizeof buffer);
+        if (size <= 0)
+            break;
+        in.append(buffer, static_cast<std::size_t>(size));
+    }
+    disconnect(connection);
+
+    ControlReply reply;
+    if (result != 1 || !decode_reply(payload, reply))
+    {
+        std::fprintf(stderr, "No valid reply from %s\n", endpoint.c_str());
+        return 1;
+    }
+
+    std::fputs(reply.text.c_str(), reply.ok ? stdout : stderr);
+    if (!reply.text.empty() && reply.text.back() != '\n')
+        std::fputc('\n', reply.ok ? stdout : stderr);
+    return reply.ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include "control_protocol.h"
+
+#include <cstdlib>
+
+namespace
+{
+    struct CommandName
+    {
+        ControlCommand command;
+        const char* name;
+    };
+
+    const CommandName kCommands[] = {
+        { ControlCommand::Status, "status" },
+        { ControlCommand::RunNow, "run-now" },
+        { ControlCommand::ReloadConfig, "reload-config" },
+        { ControlCommand::Stats, "stats" },
+        { ControlCommand::FlushLogs, "flush-logs" },
+    };
+}
+
+const char* control_command_name(ControlCommand command)
+{
+    for (const auto& entry : kCommands)
+    {
+        if (entry.command == command)
+            return entry.name;
+    }
+    return "unknown";
+}
+
+bool parse_control_command(const std::string& name, ControlCommand& command)
+{
+    for (const auto& entry : kCommands)
+    {
+        if (name == entry.name)
+        {
+            command = entry.command;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string control_endpoint(const std::string& service_name)
+{
+#ifdef _WIN32
+    return "\\\\.\\pipe\\" + service_name + "-control";
+#else
+    // RuntimeDirectory= of the systemd unit, if there is one
+    const char* runtime = std::getenv("RUNTIME_DIRECTORY");
+    if (runtime && *runtime)
+        return std::string{ runtime } + "/control.sock";
+    return "/tmp/" + service_name + "-control.sock";
+#endif
+}
+
+void append_frame(std::string& out, const std::string& payload)
+{
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    out += static_cast<char>(size & 0xff);
+    out += static_cast<char>((size >> 8) & 0xff);
+    out += static_cast<char>((size >> 16) & 0xff);
+    out += static_cast<char>((size >> 24) & 0xff);
+    out += payload;
+}
+
+int take_frame(std::string& buffer, std::string& payload)
+{
+    if (buffer.size() < kControlHeaderSize)
+        return 0;
+    const auto byte = [&](std::size_t i) { return uint32_t(static_cast<unsigned char>(buffer[i])); };
+    const uint32_t size = byte(0) | byte(1) << 8 | byte(2) << 16 | byte(3) << 24;
+    if (size > kMaxControlFrame)
+        return -1;
+    if (buffer.size() < kControlHeaderSize + size)
+        return 0;
+    payload.assign(buffer, kControlHeaderSize, size);
+    buffer.erase(0, kControlHeaderSize + size);
+    return 1;
+}
+
+std::string encode_request(const ControlRequest& request)
+{
+    std::string payload(1, static_cast<char>(request.command));
+    payload += request.argument;
+    return payload;
+}
+
+bool decode_request(const std::string& payload, ControlRequest& request)
+{
+    if (payload.empty())
+        return false;
+    request.command = static_cast<ControlCommand>(static_cast<unsigned char>(payload[0]));
+    request.argument.assign(payload, 1, std::string::npos);
+    return true;
+}
+
+std::string encode_reply(const ControlReply& reply)
+{
+    std::string payload(1, reply.ok ? '\0' : '\1');
+    payload += reply.text;
+    return payload;
+}
+
+bool decode_reply(const std::string& payload, ControlReply& reply)
+{
+    if (payload.empty())
+        return false;
+    reply.ok = payload[0] == '\0';
+    reply.text.assign(payload, 1, std::string::npos);
+    return true;
+}
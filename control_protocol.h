@@ -0,0 +1,61 @@
+#ifndef CONTROL_PROTOCOL_H
+#define CONTROL_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Wire format of the local control channel, shared by the service and the
+// service_ctl client.
+//
+// Every message is a frame: a 32 bit little endian payload length followed
+// by the payload. A request payload is one command byte followed by its
+// argument, a reply payload is one status byte (0 means success) followed
+// by UTF-8 text.
+
+enum class ControlCommand : uint8_t
+{
+    Status = 1,
+    RunNow = 2,
+    ReloadConfig = 3,
+    Stats = 4,
+    FlushLogs = 5
+};
+
+struct ControlRequest
+{
+    ControlCommand command;
+    std::string argument;
+};
+
+struct ControlReply
+{
+    bool ok;
+    std::string text;
+};
+
+// Frames above this size are rejected and the connection is dropped.
+const std::size_t kMaxControlFrame = 64 * 1024;
+// The payload size in front of every frame.
+const std::size_t kControlHeaderSize = 4;
+
+// Command names as typed on the command line, e.g. "run-now".
+const char* control_command_name(ControlCommand command);
+bool parse_control_command(const std::string& name, ControlCommand& command);
+
+// Unix socket path or named pipe name the service listens on.
+std::string control_endpoint(const std::string& service_name);
+
+void append_frame(std::string& out, const std::string& payload);
+
+// Moves the first complete frame's payload out of |buffer|. Returns 1 if a
+// frame was taken, 0 if more data is needed and -1 if the frame is too big.
+int take_frame(std::string& buffer, std::string& payload);
+
+std::string encode_request(const ControlRequest& request);
+bool decode_request(const std::string& payload, ControlRequest& request);
+
+std::string encode_reply(const ControlReply& reply);
+bool decode_reply(const std::string& payload, ControlReply& reply);
+
+#endif
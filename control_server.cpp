@@ -0,0 +1,25 @@
+#include "control_server.h"
+
+ControlServer::ControlServer(Handler handler)
+    : handler_(std::move(handler))
+{
+}
+
+ControlServer::~ControlServer()
+{
+    Close();
+}
+
+bool ControlServer::HandleInput(std::string& in, std::string& out)
+{
+    std::string payload;
+    int result;
+    while ((result = take_frame(in, payload)) == 1)
+    {
+        ControlRequest request;
+        if (!decode_request(payload, request))
+            return false;
+        append_frame(out, encode_reply(handler_(request)));
+    }
+    return result == 0;
+}
@@ -0,0 +1,92 @@
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+
+#include "control_protocol.h"
+
+// Serves the local control channel without a thread per client: every
+// connection is non-blocking and driven by one event loop.
+// On POSIX the loop belongs to the caller, which polls the descriptors
+// from AppendPollFds() along with its own and passes the results to
+// Process(). On Windows Run() is the loop, over overlapped named pipe
+// instances.
+class ControlServer
+{
+public:
+    // Runs on the loop thread, so it must return quickly.
+    using Handler = std::function<ControlReply(const ControlRequest&)>;
+
+    explicit ControlServer(Handler handler);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    bool Listen(const std::string& endpoint);
+    void Close();
+
+#ifdef _WIN32
+    // Serves clients until Stop() is called from another thread.
+    void Run();
+    void Stop();
+#else
+    void AppendPollFds(std::vector<pollfd>& fds) const;
+    // |fds| are the entries added by AppendPollFds(), after poll().
+    void Process(const pollfd* fds, std::size_t count);
+#endif
+
+private:
+    // Handles every complete request in |in|, queues the replies on |out|.
+    // Returns false if the client sent garbage and should be dropped.
+    bool HandleInput(std::string& in, std::string& out);
+
+    Handler handler_;
+    std::string endpoint_;
+
+#ifdef _WIN32
+    struct Instance
+    {
+        HANDLE pipe = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped{};
+        enum class State { Connecting, Reading, Writing } state = State::Connecting;
+        char buffer[4096];
+        std::string in;
+        std::string out;
+    };
+
+    bool Connect(Instance& instance);
+    void Reset(Instance& instance);
+    void Read(Instance& instance);
+    void Write(Instance& instance);
+    void Complete(Instance& instance);
+
+    std::vector<Instance> instances_;
+    HANDLE stop_ = nullptr;
+#else
+    struct Client
+    {
+        int fd;
+        std::string in;
+        std::string out;
+    };
+
+    void Accept();
+    bool Receive(Client& client);
+    bool Flush(Client& client);
+
+    int listen_fd_ = -1;
+    std::vector<Client> clients_;
+#endif
+};
+
+#endif
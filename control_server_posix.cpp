@@ -0,0 +1,173 @@
+#include "control_server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    // More clients than this are turned away, nobody needs that many.
+    const std::size_t kMaxClients = 16;
+}
+
+bool ControlServer::Listen(const std::string& endpoint)
+{
+    Close();
+
+    sockaddr_un address{};
+    if (endpoint.size() >= sizeof address.sun_path)
+        return false;
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ == -1)
+        return false;
+
+    // a socket left behind by a previous run would make bind() fail
+    unlink(endpoint.c_str());
+    // owner only, the commands aren't meant for other users
+    const mode_t mask = umask(0077);
+    const bool bound = bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof address) == 0;
+    umask(mask);
+    if (!bound || listen(listen_fd_, 8) == -1)
+    {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    endpoint_ = endpoint;
+    return true;
+}
+
+void ControlServer::Close()
+{
+    for (auto& client : clients_)
+        close(client.fd);
+    clients_.clear();
+    if (listen_fd_ != -1)
+    {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(endpoint_.c_str());
+    }
+}
+
+void ControlServer::AppendPollFds(std::vector<pollfd>& fds) const
+{
+    if (listen_fd_ == -1)
+        return;
+    fds.push_back({ listen_fd_, POLLIN, 0 });
+    for (const auto& client : clients_)
+    {
+        const short events = client.out.empty() ? POLLIN : POLLIN | POLLOUT;
+        fds.push_back({ client.fd, events, 0 });
+    }
+}
+
+void ControlServer::Process(const pollfd* fds, std::size_t count)
+{
+    if (listen_fd_ == -1 || count == 0)
+        return;
+
+    // entries follow the order of AppendPollFds(), clients accepted below
+    // are only polled next time
+    std::vector<int> dropped;
+    for (std::size_t i = 1; i < count && i - 1 < clients_.size(); ++i)
+    {
+        Client& client = clients_[i - 1];
+        const short revents = fds[i].revents;
+        bool keep = true;
+        if (revents & (POLLIN | POLLHUP | POLLERR))
+            keep = Receive(client);
+        if (keep && !client.out.empty())
+            keep = Flush(client);
+        if (!keep)
+            dropped.push_back(client.fd);
+    }
+
+    for (int fd : dropped)
+    {
+        for (auto it = clients_.begin(); it != clients_.end(); ++it)
+        {
+            if (it->fd == fd)
+            {
+                close(fd);
+                clients_.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (fds[0].revents & POLLIN)
+        Accept();
+}
+
+void ControlServer::Accept()
+{
+    while (true)
+    {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+            return;
+        if (clients_.size() >= kMaxClients)
+        {
+            close(fd);
+            continue;
+        }
+        clients_.push_back({ fd, std::string(), std::string() });
+    }
+}
+
+bool ControlServer::Receive(Client& client)
+{
+    char buffer[4096];
+    bool open = true;
+    while (true)
+    {
+        const ssize_t size = read(client.fd, buffer, sizeof buffer);
+        if (size > 0)
+        {
+            client.in.append(buffer, static_cast<std::size_t>(size));
+            // more than a frame can take, without waiting for a reply
+            if (client.in.size() > kControlHeaderSize + kMaxControlFrame)
+                return false;
+            continue;
+        }
+        if (size == -1 && errno == EINTR)
+            continue;
+        open = size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        break;
+    }
+
+    if (!HandleInput(client.in, client.out))
+        return false;
+    if (!open)
+    {
+        // the client is done sending, answer what it asked before closing
+        Flush(client);
+        return false;
+    }
+    return true;
+}
+
+bool ControlServer::Flush(Client& client)
+{
+    while (!client.out.empty())
+    {
+        const ssize_t size = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (size > 0)
+        {
+            client.out.erase(0, static_cast<std::size_t>(size));
+            continue;
+        }
+        if (size == -1 && errno == EINTR)
+            continue;
+        // the rest goes out once the socket is writable again
+        return size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    return true;
+}
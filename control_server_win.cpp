@@ -0,0 +1,166 @@
+#include "control_server.h"
+
+namespace
+{
+    // Pipe instances, i.e. clients served at the same time.
+    const DWORD kInstances = 4;
+}
+
+bool ControlServer::Listen(const std::string& endpoint)
+{
+    Close();
+
+    stop_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!stop_)
+        return false;
+
+    endpoint_ = endpoint;
+    instances_.resize(kInstances);
+    for (auto& instance : instances_)
+    {
+        // signaled so the first wait picks up the pending connect
+        instance.overlapped.hEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
+        instance.pipe = CreateNamedPipeA(endpoint_.c_str(),
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            kInstances, sizeof instance.buffer, sizeof instance.buffer, 0, nullptr);
+        if (!instance.overlapped.hEvent || instance.pipe == INVALID_HANDLE_VALUE || !Connect(instance))
+        {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ControlServer::Close()
+{
+    for (auto& instance : instances_)
+    {
+        if (instance.pipe != INVALID_HANDLE_VALUE)
+        {
+            CancelIo(instance.pipe);
+            CloseHandle(instance.pipe);
+        }
+        if (instance.overlapped.hEvent)
+            CloseHandle(instance.overlapped.hEvent);
+    }
+    instances_.clear();
+    if (stop_)
+    {
+        CloseHandle(stop_);
+        stop_ = nullptr;
+    }
+}
+
+void ControlServer::Run()
+{
+    std::vector<HANDLE> events;
+    for (const auto& instance : instances_)
+        events.push_back(instance.overlapped.hEvent);
+    events.push_back(stop_);
+    const DWORD count = static_cast<DWORD>(events.size());
+
+    while (true)
+    {
+        const DWORD result = WaitForMultipleObjects(count, events.data(), FALSE, INFINITE);
+        if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + count - 1)
+            return;
+        Complete(instances_[result - WAIT_OBJECT_0]);
+    }
+}
+
+void ControlServer::Stop()
+{
+    if (stop_)
+        SetEvent(stop_);
+}
+
+bool ControlServer::Connect(Instance& instance)
+{
+    instance.state = Instance::State::Connecting;
+    instance.in.clear();
+    instance.out.clear();
+    // an overlapped connect always returns zero
+    if (ConnectNamedPipe(instance.pipe, &instance.overlapped))
+        return false;
+    switch (GetLastError())
+    {
+    case ERROR_IO_PENDING:
+        return true;
+    case ERROR_PIPE_CONNECTED:
+        // the client was faster than us, there won't be a completion
+        SetEvent(instance.overlapped.hEvent);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ControlServer::Reset(Instance& instance)
+{
+    DisconnectNamedPipe(instance.pipe);
+    if (!Connect(instance))
+        ResetEvent(instance.overlapped.hEvent);
+}
+
+void ControlServer::Read(Instance& instance)
+{
+    instance.state = Instance::State::Reading;
+    if (!ReadFile(instance.pipe, instance.buffer, sizeof instance.buffer, nullptr, &instance.overlapped)
+        && GetLastError() != ERROR_IO_PENDING)
+        Reset(instance);
+}
+
+void ControlServer::Write(Instance& instance)
+{
+    instance.state = Instance::State::Writing;
+    if (!WriteFile(instance.pipe, instance.out.data(), static_cast<DWORD>(instance.out.size()), nullptr, &instance.overlapped)
+        && GetLastError() != ERROR_IO_PENDING)
+        Reset(instance);
+}
+
+void ControlServer::Complete(Instance& instance)
+{
+    // I/O that finished right away still signals the event, so every
+    // result is picked up here
+    DWORD bytes = 0;
+    const BOOL ok = GetOverlappedResult(instance.pipe, &instance.overlapped, &bytes, FALSE);
+    switch (instance.state)
+    {
+    case Instance::State::Connecting:
+        if (!ok && GetLastError() != ERROR_PIPE_CONNECTED)
+            Reset(instance);
+        else
+            Read(instance);
+        break;
+
+    case Instance::State::Reading:
+        if (!ok || bytes == 0)
+        {
+            Reset(instance);
+            break;
+        }
+        instance.in.append(instance.buffer, bytes);
+        if (!HandleInput(instance.in, instance.out))
+            Reset(instance);
+        else if (instance.out.empty())
+            Read(instance);
+        else
+            Write(instance);
+        break;
+
+    case Instance::State::Writing:
+        if (!ok)
+        {
+            Reset(instance);
+            break;
+        }
+        instance.out.erase(0, bytes);
+        if (instance.out.empty())
+            Read(instance);
+        else
+            Write(instance);
+        break;
+    }
+}
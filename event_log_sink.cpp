@@ -0,0 +1,27 @@
+#include "event_log_sink.h"
+
+EventLogSink::~EventLogSink()
+{
+    if (handle_)
+        DeregisterEventSource(handle_);
+}
+
+bool EventLogSink::Open(const std::string& source)
+{
+    if (handle_)
+        DeregisterEventSource(handle_);
+    source_ = source;
+    handle_ = RegisterEventSource(nullptr, source_.c_str());
+    return handle_ != nullptr;
+}
+
+void EventLogSink::Write(const Line* lines, std::size_t count)
+{
+    if (!handle_)
+        return;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const TCHAR* msgData[2] = { source_.c_str(), lines[i].text.c_str() };
+        ReportEvent(handle_, lines[i].type, 0, 0, nullptr, 2, 0, msgData, nullptr);
+    }
+}
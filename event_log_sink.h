@@ -0,0 +1,25 @@
+#ifndef EVENT_LOG_SINK_H
+#define EVENT_LOG_SINK_H
+
+#include "log_sink.h"
+
+// Windows event log. The event source is registered once and kept open
+// instead of being registered and deregistered for every line.
+class EventLogSink : public LogSink
+{
+public:
+    EventLogSink() = default;
+    ~EventLogSink() override;
+
+    EventLogSink(const EventLogSink&) = delete;
+    EventLogSink& operator=(const EventLogSink&) = delete;
+
+    bool Open(const std::string& source) override;
+    void Write(const Line* lines, std::size_t count) override;
+
+private:
+    std::string source_;
+    HANDLE handle_ = nullptr;
+};
+
+#endif
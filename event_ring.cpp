@@ -0,0 +1,124 @@
+#include "event_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+EventRing::EventRing(std::size_t capacity)
+{
+    std::size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    mask_ = size - 1;
+
+    // operator new only guarantees alignof(max_align_t) before C++17
+    slot_storage_.reset(new unsigned char[size * sizeof(Slot) + kCacheLine]);
+    const auto address = reinterpret_cast<uintptr_t>(slot_storage_.get());
+    slots_ = reinterpret_cast<Slot*>((address + kCacheLine - 1) & ~static_cast<uintptr_t>(kCacheLine - 1));
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        Slot* slot = new (&slots_[i]) Slot;
+        slot->sequence.store(i, std::memory_order_relaxed);
+        slot->overflow = nullptr;
+    }
+
+    // long texts are the exception, one block per 16 slots
+    blocks_ = std::max<std::size_t>(size / 16, 4);
+    arena_.reset(new char[blocks_ * kBlockSize]);
+    next_free_.reset(new std::atomic<uint32_t>[blocks_]);
+    for (std::size_t i = 0; i < blocks_; ++i)
+        next_free_[i].store(i + 1 < blocks_ ? static_cast<uint32_t>(i + 2) : 0, std::memory_order_relaxed);
+    free_head_.store(1, std::memory_order_release);
+}
+
+EventRing::~EventRing()
+{
+    Drain(Capacity(), [](const Event&) {});
+}
+
+bool EventRing::TryPush(uint16_t level, Clock::time_point time, const char* text, std::size_t size,
+                        std::size_t* queued)
+{
+    uint64_t position = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true)
+    {
+        slot = &slots_[position & mask_];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto lag = static_cast<int64_t>(sequence - position);
+        if (lag == 0)
+        {
+            if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_seq_cst,
+                                            std::memory_order_relaxed))
+                break;
+        }
+        else if (lag < 0)
+        {
+            // the consumer hasn't freed the slot from the previous lap
+            return false;
+        }
+        else
+        {
+            // another producer took it
+            position = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->time = time;
+    slot->overflow = size > kInlineSize ? Allocate(size) : nullptr;
+    if (size > kInlineSize && !slot->overflow)
+        size = kInlineSize;
+    std::memcpy(slot->overflow ? slot->overflow : slot->text, text, size);
+    slot->size = static_cast<uint32_t>(size);
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    if (queued)
+        *queued = static_cast<std::size_t>(position + 1 - head_.load(std::memory_order_relaxed));
+    return true;
+}
+
+std::size_t EventRing::Size() const
+{
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t tail = tail_.load(std::memory_order_seq_cst);
+    return tail > head ? static_cast<std::size_t>(tail - head) : 0;
+}
+
+char* EventRing::Allocate(std::size_t size)
+{
+    if (size <= kBlockSize)
+    {
+        uint64_t head = free_head_.load(std::memory_order_acquire);
+        while (static_cast<uint32_t>(head) != 0)
+        {
+            const uint32_t block = static_cast<uint32_t>(head) - 1;
+            const uint64_t next = ((head >> 32) + 1) << 32 | next_free_[block].load(std::memory_order_relaxed);
+            if (free_head_.compare_exchange_weak(head, next, std::memory_order_acquire))
+                return &arena_[block * kBlockSize];
+        }
+    }
+    // null truncates the text to what fits into the slot
+    return new (std::nothrow) char[size];
+}
+
+void EventRing::Release(char* overflow)
+{
+    const auto arena = reinterpret_cast<uintptr_t>(arena_.get());
+    const auto address = reinterpret_cast<uintptr_t>(overflow);
+    if (address < arena || address >= arena + blocks_ * kBlockSize)
+    {
+        delete[] overflow;
+        return;
+    }
+
+    const auto block = static_cast<uint32_t>((address - arena) / kBlockSize);
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        next_free_[block].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        const uint64_t next = ((head >> 32) + 1) << 32 | (block + 1);
+        if (free_head_.compare_exchange_weak(head, next, std::memory_order_release))
+            return;
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue of log events for any number of producers and one
+// consumer, after Dmitry Vyukov's bounded MPMC queue.
+// Slots are preallocated and cache line aligned so producers on different
+// cores don't write to the same lines. Pushing is a compare-and-swap on the
+// tail, a memcpy of the text into the slot and a release store. Text that
+// doesn't fit a slot goes to a block of a preallocated side arena, or to the
+// heap once the arena is used up or the text outgrows a block.
+class EventRing
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Event
+    {
+        // Whatever the producer passed, e.g. a level or EVENTLOG_*_TYPE.
+        uint16_t level;
+        Clock::time_point time;
+        const char* text;
+        std::size_t size;
+    };
+
+    // |capacity| is rounded up to a power of two.
+    explicit EventRing(std::size_t capacity);
+    ~EventRing();
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    std::size_t Capacity() const { return mask_ + 1; }
+
+    // Any thread. Copies the event into the ring, false if it's full.
+    // |queued| receives the number of events waiting including this one,
+    // to decide whether the consumer needs waking.
+    bool TryPush(uint16_t level, Clock::time_point time, const char* text, std::size_t size,
+                 std::size_t* queued = nullptr);
+
+    // Consumer only. Calls |consume| with up to |max| events in push order,
+    // the text is only valid during the call. Returns the number consumed.
+    template <typename Consume>
+    std::size_t Drain(std::size_t max, Consume consume);
+
+    // Any thread. Events claimed by producers but not consumed yet, which
+    // includes ones still being copied in. Sequentially consistent with
+    // TryPush(): a consumer that announces it's about to sleep and then
+    // finds the ring empty can count on every later push seeing the
+    // announcement, which spares producers a fence.
+    std::size_t Size() const;
+    // Events claimed by producers, and consumed, since construction.
+    uint64_t Pushed() const { return tail_.load(std::memory_order_acquire); }
+    uint64_t Popped() const { return head_.load(std::memory_order_acquire); }
+
+private:
+    static const std::size_t kSlotSize = 256;
+    static const std::size_t kCacheLine = 64;
+    static const std::size_t kBlockSize = 1024;
+
+    struct Slot
+    {
+        // Equals the push position once the slot is free for it and
+        // position + 1 once the event is published.
+        std::atomic<uint64_t> sequence;
+        Clock::time_point time;
+        // Holds the text if it didn't fit into |text|.
+        char* overflow;
+        uint32_t size;
+        uint16_t level;
+        char text[kSlotSize - sizeof(std::atomic<uint64_t>) - sizeof(Clock::time_point) - sizeof(char*)
+                  - sizeof(uint32_t) - sizeof(uint16_t)];
+    };
+    static const std::size_t kInlineSize = sizeof(Slot::text);
+    static_assert(sizeof(Slot) == kSlotSize, "slots are meant to fill whole cache lines");
+
+    char* Allocate(std::size_t size);
+    void Release(char* overflow);
+
+    std::unique_ptr<unsigned char[]> slot_storage_;
+    Slot* slots_;
+    std::size_t mask_;
+
+    // Overflow blocks, a Treiber stack of free block indexes. The head is
+    // the index + 1 of the first free block, 0 if there is none, in the low
+    // half and a counter against ABA in the high half.
+    std::unique_ptr<char[]> arena_;
+    std::size_t blocks_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_free_;
+    std::atomic<uint64_t> free_head_{ 0 };
+
+    // A line apart so producers claiming positions don't keep invalidating
+    // the consumer's. Padded rather than aligned, owners are allocated with
+    // plain operator new.
+    std::atomic<uint64_t> tail_{ 0 };
+    char tail_padding_[kCacheLine];
+    std::atomic<uint64_t> head_{ 0 };
+};
+
+template <typename Consume>
+std::size_t EventRing::Drain(std::size_t max, Consume consume)
+{
+    uint64_t position = head_.load(std::memory_order_relaxed);
+    std::size_t count = 0;
+    for (; count < max; ++count, ++position)
+    {
+        Slot& slot = slots_[position & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+            break;
+        consume(Event{ slot.level, slot.time, slot.overflow ? slot.overflow : slot.text, slot.size });
+        if (slot.overflow)
+            Release(slot.overflow);
+        // free for the push one lap later
+        slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+        head_.store(position + 1, std::memory_order_release);
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "feed_cache.h"
+
+#include <experimental/filesystem>
+#include <fstream>
+
+#include "json.hpp"
+
+namespace fs = std::experimental::filesystem;
+using nlohmann::json;
+
+bool FeedCache::Load(const std::string& path, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    entries_.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open())
+        return true;
+
+    try
+    {
+        json cache;
+        file >> cache;
+        for (auto it = cache.begin(); it != cache.end(); ++it)
+        {
+            const json& value = it.value();
+            Entry entry;
+            entry.fingerprint.etag = value.value("etag", std::string());
+            entry.fingerprint.modified = value.value("modified", int64_t{ -1 });
+            entry.fingerprint.size = value.value("size", int64_t{ -1 });
+            entry.fingerprint.hash = value.value("hash", uint64_t{ 0 });
+            entry.launched = value.value("launched", int64_t{ 0 });
+            entries_[it.key()] = entry;
+        }
+    }
+    catch (json::exception& e)
+    {
+        // every job checks its feed once more and the file is rewritten
+        entries_.clear();
+        error = path + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+bool FeedCache::Find(const std::string& job, Entry& entry) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = entries_.find(job);
+    if (it == entries_.end())
+        return false;
+    entry = it->second;
+    return true;
+}
+
+bool FeedCache::Store(const std::string& job, const Entry& entry, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[job] = entry;
+    if (path_.empty())
+        return true;
+
+    json cache = json::object();
+    for (const auto& it : entries_)
+    {
+        const FeedFingerprint& fingerprint = it.second.fingerprint;
+        cache[it.first] = {
+            { "etag", fingerprint.etag },
+            { "modified", fingerprint.modified },
+            { "size", fingerprint.size },
+            { "hash", fingerprint.hash },
+            { "launched", it.second.launched }
+        };
+    }
+
+    // a crash while writing leaves the previous file in place
+    const std::string temporary = path_ + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << cache.dump(2);
+        if (!file.flush())
+        {
+            error = "Cannot write " + temporary;
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temporary, path_, ec);
+    if (ec)
+    {
+        error = "Cannot replace " + path_ + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
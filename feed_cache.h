@@ -0,0 +1,38 @@
+#ifndef FEED_CACHE_H
+#define FEED_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "feed_probe.h"
+
+// Feed fingerprints the updaters last ran against, by job name.
+// Kept in a small JSON file so a restart doesn't cost every job a launch.
+// Thread safe, jobs running in parallel store their entries concurrently.
+class FeedCache
+{
+public:
+    struct Entry
+    {
+        FeedFingerprint fingerprint;
+        // When the updater last ran, seconds since the epoch.
+        int64_t launched = 0;
+    };
+
+    // Reads |path|, a missing file is an empty cache. Entries go to the
+    // same file.
+    bool Load(const std::string& path, std::string& error);
+
+    bool Find(const std::string& job, Entry& entry) const;
+    // Records |entry| for |job| and rewrites the file.
+    bool Store(const std::string& job, const Entry& entry, std::string& error);
+
+private:
+    mutable std::mutex mutex_;
+    std::string path_;
+    std::map<std::string, Entry> entries_;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "feed_probe.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+    const long kConnectTimeout = 10;
+    const long kMaxRedirects = 5;
+    const uint64_t kFnvOffset = 14695981039346656037ull;
+    const uint64_t kFnvPrime = 1099511628211ull;
+
+    struct Response
+    {
+        uint64_t hash = kFnvOffset;
+        int64_t size = 0;
+        std::string etag;
+    };
+
+    bool starts_with_nocase(const char* text, std::size_t length, const char* prefix)
+    {
+        const std::size_t prefix_length = std::strlen(prefix);
+        if (length < prefix_length)
+            return false;
+        for (std::size_t i = 0; i < prefix_length; ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(text[i])) != prefix[i])
+                return false;
+        }
+        return true;
+    }
+
+    size_t hash_body(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        Response* response = static_cast<Response*>(userdata);
+        const size_t length = size * nmemb;
+        // FNV-1a, the body is only compared with its previous version
+        uint64_t hash = response->hash;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(ptr[i]);
+            hash *= kFnvPrime;
+        }
+        response->hash = hash;
+        response->size += static_cast<int64_t>(length);
+        return length;
+    }
+
+    size_t read_header(char* buffer, size_t size, size_t nitems, void* userdata)
+    {
+        Response* response = static_cast<Response*>(userdata);
+        const size_t length = size * nitems;
+        // a new status line starts the headers of a redirect target
+        if (starts_with_nocase(buffer, length, "http/"))
+        {
+            response->etag.clear();
+        }
+        else if (starts_with_nocase(buffer, length, "etag:"))
+        {
+            std::string value(buffer + 5, length - 5);
+            const auto first = value.find_first_not_of(" \t");
+            const auto last = value.find_last_not_of(" \t\r\n");
+            response->etag = first == std::string::npos ? std::string() : value.substr(first, last - first + 1);
+        }
+        return length;
+    }
+
+    int check_cancelled(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+        const auto* cancelled = static_cast<const std::function<bool()>*>(clientp);
+        return (*cancelled)() ? 1 : 0;
+    }
+}
+
+FeedProbe::FeedProbe(std::function<bool()> cancelled)
+    : cancelled_(std::move(cancelled))
+{
+}
+
+FeedProbe::~FeedProbe()
+{
+    Close();
+}
+
+void FeedProbe::Close()
+{
+    if (curl_)
+    {
+        curl_easy_cleanup(curl_);
+        curl_ = nullptr;
+    }
+}
+
+bool FeedProbe::Open(const std::string& url, const std::string& credentials)
+{
+    Close();
+    url_ = url;
+    credentials_ = credentials;
+    http_ = starts_with_nocase(url.c_str(), url.size(), "http://")
+        || starts_with_nocase(url.c_str(), url.size(), "https://");
+
+    curl_ = curl_easy_init();
+    if (!curl_)
+        return false;
+
+    curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
+    if (!credentials_.empty())
+        curl_easy_setopt(curl_, CURLOPT_USERPWD, credentials_.c_str());
+    curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT, kConnectTimeout);
+    curl_easy_setopt(curl_, CURLOPT_TIMEOUT, static_cast<long>(Timeout().count()));
+    curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl_, CURLOPT_XFERINFOFUNCTION, check_cancelled);
+    curl_easy_setopt(curl_, CURLOPT_XFERINFODATA, &cancelled_);
+    curl_easy_setopt(curl_, CURLOPT_FILETIME, 1L);
+    if (http_)
+    {
+        curl_easy_setopt(curl_, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl_, CURLOPT_MAXREDIRS, kMaxRedirects);
+        curl_easy_setopt(curl_, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, hash_body);
+        curl_easy_setopt(curl_, CURLOPT_HEADERFUNCTION, read_header);
+    }
+    else
+    {
+        // MDTM and SIZE, the feed itself isn't transferred
+        curl_easy_setopt(curl_, CURLOPT_NOBODY, 1L);
+    }
+    return true;
+}
+
+FeedProbe::Result FeedProbe::Check(const std::string& url, const std::string& credentials,
+                                   const FeedFingerprint& known, FeedFingerprint& current, std::string& error)
+{
+    if ((!curl_ || url != url_ || credentials != credentials_) && !Open(url, credentials))
+    {
+        error = "curl_easy_init failed";
+        return Result::Failed;
+    }
+
+    Response response;
+    curl_slist* headers = nullptr;
+    if (http_)
+    {
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response);
+        curl_easy_setopt(curl_, CURLOPT_HEADERDATA, &response);
+        if (!known.etag.empty())
+            headers = curl_slist_append(headers, ("If-None-Match: " + known.etag).c_str());
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl_, CURLOPT_TIMECONDITION,
+                         known.modified >= 0 ? static_cast<long>(CURL_TIMECOND_IFMODSINCE) : static_cast<long>(CURL_TIMECOND_NONE));
+        curl_easy_setopt(curl_, CURLOPT_TIMEVALUE_LARGE, static_cast<curl_off_t>(std::max<int64_t>(known.modified, 0)));
+    }
+
+    const CURLcode res = curl_easy_perform(curl_);
+    if (http_)
+    {
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, nullptr);
+        curl_slist_free_all(headers);
+    }
+    if (res != CURLE_OK)
+    {
+        error = curl_easy_strerror(res);
+        return Result::Failed;
+    }
+
+    curl_off_t modified = -1;
+    curl_easy_getinfo(curl_, CURLINFO_FILETIME_T, &modified);
+
+    if (!http_)
+    {
+        curl_off_t size = -1;
+        curl_easy_getinfo(curl_, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+        if (modified < 0 && size < 0)
+        {
+            error = "the server reports neither modification time nor size";
+            return Result::Failed;
+        }
+        current = FeedFingerprint{};
+        current.modified = modified;
+        current.size = size;
+        return current == known ? Result::Unchanged : Result::Changed;
+    }
+
+    long status = 0;
+    long unmet = 0;
+    curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl_, CURLINFO_CONDITION_UNMET, &unmet);
+    if (status == 304 || unmet)
+    {
+        current = known;
+        return Result::Unchanged;
+    }
+    if (status != 200)
+    {
+        error = "HTTP status " + std::to_string(status);
+        return Result::Failed;
+    }
+
+    current.etag = std::move(response.etag);
+    current.modified = modified;
+    current.size = response.size;
+    current.hash = response.hash;
+    // same content under new validators, e.g. a server that doesn't send any
+    return current.hash == known.hash && current.size == known.size ? Result::Unchanged : Result::Changed;
+}
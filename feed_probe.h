@@ -0,0 +1,82 @@
+#ifndef FEED_PROBE_H
+#define FEED_PROBE_H
+
+#include <chrono>
+#include <cstdint>
+#include <curl/curl.h>
+#include <functional>
+#include <string>
+
+// What identifies one version of an update feed.
+struct FeedFingerprint
+{
+    // HTTP only.
+    std::string etag;
+    // Last-Modified or MDTM, seconds since the epoch, -1 if unknown.
+    int64_t modified = -1;
+    // Content-Length or SIZE, -1 if unknown.
+    int64_t size = -1;
+    // Hash of the body when it was downloaded, 0 if it wasn't.
+    uint64_t hash = 0;
+
+    bool Empty() const { return etag.empty() && modified < 0 && size < 0 && hash == 0; }
+};
+
+inline bool operator==(const FeedFingerprint& a, const FeedFingerprint& b)
+{
+    return a.etag == b.etag && a.modified == b.modified && a.size == b.size && a.hash == b.hash;
+}
+
+inline bool operator!=(const FeedFingerprint& a, const FeedFingerprint& b)
+{
+    return !(a == b);
+}
+
+// Asks the server whether an update feed changed since the updater last
+// read it, without downloading it where the protocol allows:
+// - HTTP(S): GET with If-None-Match and If-Modified-Since, 304 means
+//   unchanged. A full response is hashed so servers without validators
+//   still only count as changed when the content did.
+// - FTP(S) and others: MDTM and SIZE, no transfer.
+// Keeps its handle, and so the connection, between checks. Not thread safe.
+class FeedProbe
+{
+public:
+    enum class Result
+    {
+        Unchanged,
+        Changed,
+        // the caller can't tell and should run the updater
+        Failed
+    };
+
+    // Longest a check takes before it fails.
+    static std::chrono::seconds Timeout() { return std::chrono::seconds{ 40 }; }
+
+    // A check in progress is aborted once |cancelled| returns true.
+    explicit FeedProbe(std::function<bool()> cancelled);
+    ~FeedProbe();
+
+    FeedProbe(const FeedProbe&) = delete;
+    FeedProbe& operator=(const FeedProbe&) = delete;
+
+    // Compares the feed at |url| with |known|. |credentials| are
+    // "user:password" or empty. Fills |current| unless it fails, in which
+    // case |error| says why.
+    Result Check(const std::string& url, const std::string& credentials, const FeedFingerprint& known,
+                 FeedFingerprint& current, std::string& error);
+
+    // Frees the handle, the next check opens a new one.
+    void Close();
+
+private:
+    bool Open(const std::string& url, const std::string& credentials);
+
+    std::function<bool()> cancelled_;
+    CURL* curl_ = nullptr;
+    std::string url_;
+    std::string credentials_;
+    bool http_ = false;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "gzip_writer.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+
+namespace
+{
+    // 15 bits of window plus 16 asks zlib for a gzip header and trailer.
+    const int kGzipWindowBits = 15 + 16;
+    const int kMemLevel = 8;
+    const std::size_t kMinChunk = 4096;
+}
+
+//static
+bool GzipWriter::Available()
+{
+    return true;
+}
+
+GzipWriter::GzipWriter(int level)
+    : stream_(new z_stream_s())
+{
+    ok_ = deflateInit2(stream_.get(), level, Z_DEFLATED, kGzipWindowBits,
+                       kMemLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+GzipWriter::~GzipWriter()
+{
+    if (ok_)
+        deflateEnd(stream_.get());
+}
+
+bool GzipWriter::Reset()
+{
+    out_size_ = 0;
+    bytes_in_ = 0;
+    return ok_ && deflateReset(stream_.get()) == Z_OK;
+}
+
+bool GzipWriter::Deflate(int flush)
+{
+    z_stream_s& zs = *stream_;
+    while (true)
+    {
+        if (out_.size() - out_size_ < kMinChunk)
+            out_.resize(out_.size() * 2 + kMinChunk);
+
+        zs.next_out = reinterpret_cast<Bytef*>(&out_[out_size_]);
+        zs.avail_out = static_cast<uInt>(out_.size() - out_size_);
+        const int res = deflate(&zs, flush);
+        out_size_ = out_.size() - zs.avail_out;
+
+        if (res == Z_STREAM_END)
+            return true;
+        if (res != Z_OK && res != Z_BUF_ERROR)
+            return false;
+        // done once zlib stops filling the whole output window
+        if (zs.avail_out != 0 && zs.avail_in == 0 && flush == Z_NO_FLUSH)
+            return true;
+    }
+}
+
+bool GzipWriter::Write(const char* data, std::size_t size)
+{
+    if (!ok_)
+        return false;
+
+    bytes_in_ += size;
+    stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream_->avail_in = static_cast<uInt>(size);
+    return Deflate(Z_NO_FLUSH);
+}
+
+bool GzipWriter::Finish()
+{
+    if (!ok_)
+        return false;
+
+    stream_->next_in = nullptr;
+    stream_->avail_in = 0;
+    const bool res = Deflate(Z_FINISH);
+    out_.resize(out_size_);
+    return res;
+}
+
+#else
+
+struct z_stream_s
+{
+};
+
+//static
+bool GzipWriter::Available()
+{
+    return false;
+}
+
+GzipWriter::GzipWriter(int /*level*/)
+{
+}
+
+GzipWriter::~GzipWriter()
+{
+}
+
+bool GzipWriter::Reset()
+{
+    return false;
+}
+
+bool GzipWriter::Write(const char* /*data*/, std::size_t /*size*/)
+{
+    return false;
+}
+
+bool GzipWriter::Finish()
+{
+    return false;
+}
+
+#endif
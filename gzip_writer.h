@@ -0,0 +1,46 @@
+#ifndef GZIP_WRITER_H
+#define GZIP_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct z_stream_s;
+
+// Streaming gzip compressor writing into a reusable output buffer.
+// Data is compressed as it is written, the uncompressed input is never
+// materialized. Only functional when built with zlib (HAVE_ZLIB).
+class GzipWriter
+{
+public:
+    static bool Available();
+
+    // |level| is a zlib compression level, -1 for the zlib default.
+    explicit GzipWriter(int level = -1);
+    ~GzipWriter();
+
+    GzipWriter(const GzipWriter&) = delete;
+    GzipWriter& operator=(const GzipWriter&) = delete;
+
+    // Starts a new gzip member, keeps the output buffer capacity.
+    bool Reset();
+    bool Write(const char* data, std::size_t size);
+    bool Write(const std::string& data) { return Write(data.data(), data.size()); }
+    // Flushes the compressor, Output() holds a complete gzip stream after it.
+    bool Finish();
+
+    const std::string& Output() const { return out_; }
+    uint64_t BytesIn() const { return bytes_in_; }
+
+private:
+    bool Deflate(int flush);
+
+    std::unique_ptr<z_stream_s> stream_;
+    bool ok_ = false;
+    std::string out_;
+    std::size_t out_size_ = 0;
+    uint64_t bytes_in_ = 0;
+};
+
+#endif
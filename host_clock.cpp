@@ -0,0 +1,148 @@
+#include "host_clock.h"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    std::mutex name_mutex;
+    std::string cached_name;
+    bool name_cached = false;
+
+    std::string query_machine_name()
+    {
+#ifdef _WIN32
+        char p[MAX_COMPUTERNAME_LENGTH + 1];
+        DWORD size = sizeof p;
+        if (GetComputerName(p, &size))
+            return { p, size };
+#else
+        char p[256];
+        if (gethostname(p, sizeof p) == 0)
+        {
+            p[sizeof p - 1] = '\0';
+            return p;
+        }
+#endif
+        return {};
+    }
+
+    void put2(char* out, unsigned value)
+    {
+        out[0] = static_cast<char>('0' + value / 10);
+        out[1] = static_cast<char>('0' + value % 10);
+    }
+
+    // Days since 1970-01-01 to a civil date, see
+    // http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+    void civil_from_days(int64_t days, int64_t& year, unsigned& month, unsigned& day)
+    {
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(days - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        day = doy - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+    }
+
+    // "YYYY-MM-DDTHH:MM:SS"
+    const std::size_t kPrefixSize = 19;
+
+    struct SecondCache
+    {
+        int64_t second = INT64_MIN;
+        char prefix[kPrefixSize];
+    };
+
+    void format_prefix(char* out, int64_t second)
+    {
+        int64_t days = second / 86400;
+        int64_t rem = second % 86400;
+        if (rem < 0)
+        {
+            rem += 86400;
+            --days;
+        }
+
+        int64_t year;
+        unsigned month;
+        unsigned day;
+        civil_from_days(days, year, month, day);
+
+        const unsigned y = static_cast<unsigned>(year % 10000);
+        put2(out, y / 100);
+        put2(out + 2, y % 100);
+        out[4] = '-';
+        put2(out + 5, month);
+        out[7] = '-';
+        put2(out + 8, day);
+        out[10] = 'T';
+        put2(out + 11, static_cast<unsigned>(rem / 3600));
+        out[13] = ':';
+        put2(out + 14, static_cast<unsigned>(rem / 60 % 60));
+        out[16] = ':';
+        put2(out + 17, static_cast<unsigned>(rem % 60));
+    }
+}
+
+std::string machine_name()
+{
+    std::lock_guard<std::mutex> lock(name_mutex);
+    if (!name_cached)
+    {
+        cached_name = query_machine_name();
+        name_cached = true;
+    }
+    return cached_name;
+}
+
+void refresh_machine_name()
+{
+    std::string name = query_machine_name();
+    std::lock_guard<std::mutex> lock(name_mutex);
+    cached_name.swap(name);
+    name_cached = true;
+}
+
+std::size_t format_timestamp(char* buf, std::chrono::system_clock::time_point time)
+{
+    using namespace std::chrono;
+    thread_local SecondCache cache;
+
+    const int64_t us = duration_cast<microseconds>(time.time_since_epoch()).count();
+    int64_t second = us / 1000000;
+    int64_t fraction = us % 1000000;
+    if (fraction < 0)
+    {
+        fraction += 1000000;
+        --second;
+    }
+
+    if (second != cache.second)
+    {
+        format_prefix(cache.prefix, second);
+        cache.second = second;
+    }
+
+    std::memcpy(buf, cache.prefix, kPrefixSize);
+    char* p = buf + kPrefixSize;
+    *p++ = '.';
+    unsigned f = static_cast<unsigned>(fraction);
+    for (int i = 5; i >= 0; --i)
+    {
+        p[i] = static_cast<char>('0' + f % 10);
+        f /= 10;
+    }
+    p[6] = 'Z';
+    return kTimestampSize;
+}
@@ -0,0 +1,30 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Host identity and event timestamps for log records.
+
+// Machine name, queried from the system once and cached afterwards.
+std::string machine_name();
+
+// Queries the system again, e.g. after the host was renamed.
+void refresh_machine_name();
+
+// "YYYY-MM-DDTHH:MM:SS.uuuuuuZ"
+const std::size_t kTimestampSize = 27;
+
+// Writes |time| as an RFC 3339 UTC timestamp with microseconds into |buf|,
+// which must hold at least kTimestampSize bytes. Returns the bytes written.
+// The date part is cached per thread and only recomputed when the second
+// changes, no localtime/gmtime involved.
+std::size_t format_timestamp(char* buf, std::chrono::system_clock::time_point time);
+
+inline std::size_t format_timestamp(char* buf)
+{
+    return format_timestamp(buf, std::chrono::system_clock::now());
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Times posting log batches to a StandInServer on a local port, one POST
+// at a time: as the service did before HttpClient, with curl initialized,
+// a fresh easy handle and header list and a new connection per POST on a
+// thread of its own, against one long-lived HttpClient whose connection
+// stays open between POSTs.
+//
+//   http_bench [posts] [events per post]
+
+#include "clef_writer.h"
+#include "http_client.h"
+#include "stand_in_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <curl/curl.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t discard_response(char* /*ptr*/, size_t size, size_t nmemb, void* /*userdata*/)
+    {
+        return size * nmemb;
+    }
+
+    // The service's log_send lambda, minus the event log. Its response went
+    // to stdout, here it's discarded.
+    bool post_fresh(const std::string& url, const std::string& body)
+    {
+        bool ok = false;
+        std::thread([&] {
+            curl_global_init(CURL_GLOBAL_ALL);
+            CURL* curl = curl_easy_init();
+            if (curl)
+            {
+                curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+                curl_easy_setopt(curl, CURLOPT_POST, 1L);
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_response);
+                curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+                ok = curl_easy_perform(curl) == CURLE_OK;
+                curl_easy_cleanup(curl);
+                curl_slist_free_all(headers);
+            }
+            curl_global_cleanup();
+        }).join();
+        return ok;
+    }
+
+    bool post_reused(HttpClient& client, const std::string& body, uint64_t id)
+    {
+        std::vector<HttpClient::Completion> done;
+        if (!client.Start(body, id))
+            return false;
+        while (done.empty())
+            client.Poll(std::chrono::milliseconds{ 1000 }, done);
+        return done.front().ok;
+    }
+
+    std::string make_body(std::size_t events)
+    {
+        ClefWriter writer;
+        writer.Init("(windows_updater: {machine_name}) {msg}", "bench");
+        const std::string timestamp = "2024-01-01T00:00:00.000Z";
+        std::string body = "{\"Events\":[";
+        for (std::size_t i = 0; i < events; ++i)
+        {
+            const LogRecord record("job{job}: next run at {next_run}", i % 8, "2024-01-01 00:05:00");
+            if (i != 0)
+                body += ',';
+            writer.Append(body, ClefWriter::Level::Debug, timestamp.data(), timestamp.size(), record.Data(),
+                          record.Size());
+        }
+        body += "]}";
+        return body;
+    }
+
+    template <typename Post>
+    void run(const char* name, const StandInServer& server, std::size_t posts, Post post)
+    {
+        const uint64_t connections = server.Connections();
+        std::vector<double> samples;
+        samples.reserve(posts);
+        std::size_t failed = 0;
+        for (std::size_t i = 0; i < posts; ++i)
+        {
+            const auto before = Clock::now();
+            if (!post(i))
+                ++failed;
+            const std::chrono::duration<double, std::micro> elapsed = Clock::now() - before;
+            samples.push_back(elapsed.count());
+        }
+        double total = 0;
+        for (double sample : samples)
+            total += sample;
+        std::sort(samples.begin(), samples.end());
+        const auto at = [&](double quantile) {
+            return samples[std::min(samples.size() - 1, static_cast<std::size_t>(quantile * samples.size()))];
+        };
+        std::printf("  %-8s mean %7.1f  p50 %7.1f  p99 %7.1f us  %llu connections  %zu failed\n", name,
+                    total / samples.size(), at(0.5), at(0.99),
+                    static_cast<unsigned long long>(server.Connections() - connections), failed);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t posts = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    const std::size_t events = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    const std::string body = make_body(events);
+    std::printf("%zu posts of %zu events, %zu bytes each\n", posts, events, body.size());
+
+    // outlives main(), its connection threads are detached
+    const StandInServer& server = *new StandInServer();
+    const std::string url = "http://127.0.0.1:" + std::to_string(server.Port()) + "/api/events/raw";
+
+    run("before", server, posts, [&](std::size_t) { return post_fresh(url, body); });
+
+    HttpClient::GlobalInit();
+    {
+        HttpClient client(url);
+        run("after", server, posts, [&](std::size_t i) { return post_reused(client, body, i); });
+    }
+    HttpClient::GlobalCleanup();
+    return 0;
+}
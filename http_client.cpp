@@ -0,0 +1,219 @@
+#include "http_client.h"
+
+#include <algorithm>
+#include <curl/curl.h>
+#include <thread>
+
+namespace
+{
+    // Keep resolved addresses warm, the endpoint never changes.
+    const long kDnsCacheTimeout = 3600;
+    const long kKeepAliveIdle = 60;
+    // Undeliverable batches go to the spool, fail fast instead of stalling
+    // the shipper on an unreachable server.
+    const long kConnectTimeout = 10;
+    const long kRequestTimeout = 30;
+
+    size_t discard_response(char* /*ptr*/, size_t size, size_t nmemb, void* /*userdata*/)
+    {
+        return size * nmemb;
+    }
+}
+
+//static
+bool HttpClient::GlobalInit()
+{
+    return curl_global_init(CURL_GLOBAL_ALL) == CURLE_OK;
+}
+
+//static
+void HttpClient::GlobalCleanup()
+{
+    curl_global_cleanup();
+}
+
+//static
+bool HttpClient::Http2Available()
+{
+    return (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+}
+
+HttpClient::HttpClient(const std::string& url, const std::string& content_encoding, std::size_t max_in_flight,
+                       bool h2c)
+    : url_(url)
+    , http_version_(!Http2Available() ? CURL_HTTP_VERSION_1_1
+                    : h2c ? CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE : CURL_HTTP_VERSION_2TLS)
+    , headers_(nullptr)
+    , multi_(curl_multi_init())
+    , slots_(std::max<std::size_t>(max_in_flight, 1))
+{
+    headers_ = curl_slist_append(headers_, "Content-Type: application/json");
+    // no round trip waiting for "100 Continue" before each batch
+    headers_ = curl_slist_append(headers_, "Expect:");
+    if (!content_encoding.empty())
+        headers_ = curl_slist_append(headers_, ("Content-Encoding: " + content_encoding).c_str());
+    if (multi_)
+    {
+        // up to one connection per request in flight, or with HTTP/2 one
+        // connection carrying every request if the server allows it
+        if (http_version_ != CURL_HTTP_VERSION_1_1)
+            curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(slots_.size()));
+        curl_multi_setopt(multi_, CURLMOPT_MAXCONNECTS, static_cast<long>(slots_.size()));
+    }
+}
+
+HttpClient::~HttpClient()
+{
+    for (auto& slot : slots_)
+    {
+        if (!slot.curl)
+            continue;
+        if (slot.busy)
+            curl_multi_remove_handle(multi_, slot.curl);
+        curl_easy_cleanup(slot.curl);
+    }
+    if (multi_)
+        curl_multi_cleanup(multi_);
+    curl_slist_free_all(headers_);
+}
+
+void HttpClient::SetUrl(const std::string& url)
+{
+    url_ = url;
+}
+
+bool HttpClient::Open(Slot& slot)
+{
+    slot.curl = curl_easy_init();
+    if (!slot.curl)
+        return false;
+
+    CURL* curl = slot.curl;
+    if (curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, http_version_) != CURLE_OK)
+    {
+        curl_easy_cleanup(curl);
+        slot.curl = nullptr;
+        return false;
+    }
+    if (http_version_ != CURL_HTTP_VERSION_1_1)
+    {
+        // wait for a connection that might multiplex rather than open another
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, &slot);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers_);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, kKeepAliveIdle);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, kKeepAliveIdle);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, kDnsCacheTimeout);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kConnectTimeout);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, kRequestTimeout);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_response);
+    return true;
+}
+
+bool HttpClient::Start(const std::string& body, uint64_t id, std::string* error)
+{
+    const auto slot = std::find_if(slots_.begin(), slots_.end(), [](const Slot& s) { return !s.busy; });
+    if (slot == slots_.end())
+    {
+        if (error)
+            *error = "too many requests in flight";
+        return false;
+    }
+    // a previous init failed, try again instead of giving up for good
+    if (!multi_ || (!slot->curl && !Open(*slot)))
+    {
+        if (error)
+            *error = "cannot set up a curl handle";
+        return false;
+    }
+
+    // the copy is kept by the slot and reuses its buffer
+    slot->body.assign(body);
+    slot->id = id;
+    curl_easy_setopt(slot->curl, CURLOPT_URL, url_.c_str());
+    curl_easy_setopt(slot->curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(slot->body.size()));
+    curl_easy_setopt(slot->curl, CURLOPT_POSTFIELDS, slot->body.data());
+    const CURLMcode res = curl_multi_add_handle(multi_, slot->curl);
+    if (res != CURLM_OK)
+    {
+        if (error)
+            *error = curl_multi_strerror(res);
+        return false;
+    }
+    slot->busy = true;
+    ++in_flight_;
+    return true;
+}
+
+void HttpClient::Poll(std::chrono::milliseconds timeout, std::vector<Completion>& done)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + timeout;
+    const std::size_t finished = done.size();
+    while (in_flight_ != 0)
+    {
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+        Collect(done);
+        const auto now = Clock::now();
+        if (done.size() != finished || in_flight_ == 0 || now >= deadline)
+            return;
+
+        // curl_multi_wait() is capped by curl's own timers
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+        int descriptors = 0;
+        if (curl_multi_wait(multi_, nullptr, 0, static_cast<int>(remaining.count()) + 1, &descriptors) != CURLM_OK)
+            return;
+        // this curl returns at once when it has no socket to wait on, e.g.
+        // while resolving, then sleep until its next timer instead of
+        // spinning. A zero timer, as set while sending a body, means go on.
+        if (descriptors == 0 && Clock::now() - now < std::chrono::milliseconds{ 1 })
+        {
+            long next_timer = -1;
+            curl_multi_timeout(multi_, &next_timer);
+            if (next_timer != 0)
+                std::this_thread::sleep_for(std::min(
+                    remaining, std::chrono::milliseconds{ next_timer < 0 || next_timer > 5 ? 5 : next_timer }));
+        }
+    }
+}
+
+void HttpClient::Collect(std::vector<Completion>& done)
+{
+    int queued = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi_, &queued))
+    {
+        if (message->msg != CURLMSG_DONE)
+            continue;
+
+        char* data = nullptr;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &data);
+        Slot& slot = *reinterpret_cast<Slot*>(data);
+        Completion completion{ slot.id, true, std::string() };
+        if (message->data.result != CURLE_OK)
+        {
+            completion.ok = false;
+            completion.error = curl_easy_strerror(message->data.result);
+        }
+        else
+        {
+            long status = 0;
+            curl_easy_getinfo(slot.curl, CURLINFO_RESPONSE_CODE, &status);
+            if (status >= 400)
+            {
+                completion.ok = false;
+                completion.error = "HTTP status " + std::to_string(status);
+            }
+        }
+
+        curl_multi_remove_handle(multi_, slot.curl);
+        slot.busy = false;
+        --in_flight_;
+        done.push_back(std::move(completion));
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <curl/curl.h>
+#include <string>
+#include <vector>
+
+// Long-lived HTTP client for posting to one endpoint, with up to
+// |max_in_flight| requests running at once on one curl multi handle.
+// Requests share a pool of up to |max_in_flight| keep-alive connections.
+// If curl was built with nghttp2 they are multiplexed over one HTTP/2
+// connection instead: negotiated for https, and for plain http only with
+// |h2c|, which assumes the server speaks HTTP/2 without an upgrade, so only
+// set it for servers that do. Easy handles are kept
+// and reused so connections, the DNS cache and headers survive between
+// requests. Transfers only make progress inside Poll(), which runs them on
+// the calling thread. Not thread safe, use it from one thread only.
+class HttpClient
+{
+public:
+    struct Completion
+    {
+        uint64_t id;
+        bool ok;
+        // Set if !ok.
+        std::string error;
+    };
+
+    // Call once per process before creating any client and after the last
+    // one is destroyed.
+    static bool GlobalInit();
+    static void GlobalCleanup();
+    // Whether curl was built with HTTP/2 support.
+    static bool Http2Available();
+
+    // A non-empty |content_encoding| is sent as the Content-Encoding header
+    // of every request, the caller encodes bodies accordingly.
+    explicit HttpClient(const std::string& url, const std::string& content_encoding = std::string(),
+                        std::size_t max_in_flight = 1, bool h2c = false);
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // Used by requests started from now on.
+    void SetUrl(const std::string& url);
+    const std::string& Url() const { return url_; }
+
+    std::size_t InFlight() const { return in_flight_; }
+    std::size_t Capacity() const { return slots_.size(); }
+
+    // Starts posting a copy of |body| as application/json, |id| comes back
+    // with its Completion. Returns false with a reason in |error| if
+    // Capacity() requests are running already or no handle is available.
+    bool Start(const std::string& body, uint64_t id, std::string* error = nullptr);
+
+    // Runs the transfers until at least one finishes or |timeout| passes
+    // and appends the finished ones to |done|. Returns at once when nothing
+    // is in flight.
+    void Poll(std::chrono::milliseconds timeout, std::vector<Completion>& done);
+
+private:
+    struct Slot
+    {
+        CURL* curl = nullptr;
+        std::string body;
+        uint64_t id = 0;
+        bool busy = false;
+    };
+
+    bool Open(Slot& slot);
+    void Collect(std::vector<Completion>& done);
+
+    std::string url_;
+    // CURL_HTTP_VERSION_*, HTTP/1.1 if curl has no HTTP/2.
+    const long http_version_;
+    curl_slist* headers_;
+    CURLM* multi_;
+    std::vector<Slot> slots_;
+    std::size_t in_flight_ = 0;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "job_scheduler.h"
+
+#include <algorithm>
+
+JobScheduler::JobScheduler(std::size_t max_concurrent)
+    : max_concurrent_(std::max<std::size_t>(max_concurrent, 1))
+{
+}
+
+JobScheduler::~JobScheduler()
+{
+    Stop();
+}
+
+void JobScheduler::Add(Job job)
+{
+    jobs_.push_back(std::move(job));
+}
+
+void JobScheduler::Start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!workers_.empty())
+        return;
+
+    stop_ = false;
+    timers_ = {};
+    generations_.assign(jobs_.size(), 0);
+    due_.assign(jobs_.size(), Clock::time_point{});
+    running_.assign(jobs_.size(), false);
+    for (std::size_t i = 0; i < jobs_.size(); ++i)
+    {
+        timers_.push({ jobs_[i].first, i, 0 });
+        due_[i] = jobs_[i].first;
+    }
+
+    const std::size_t count = std::min(max_concurrent_, jobs_.size());
+    for (std::size_t i = 0; i < count; ++i)
+        workers_.emplace_back(&JobScheduler::Worker, this);
+}
+
+void JobScheduler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+    workers_.clear();
+}
+
+void JobScheduler::Worker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_)
+    {
+        if (timers_.empty())
+        {
+            cv_.wait(lock);
+            continue;
+        }
+
+        const Timer timer = timers_.top();
+        if (timer.generation != generations_[timer.job])
+        {
+            timers_.pop();
+            continue;
+        }
+        if (Clock::now() < timer.due)
+        {
+            // woken early when a run is queued or the scheduler stops
+            cv_.wait_until(lock, timer.due);
+            continue;
+        }
+        timers_.pop();
+        running_[timer.job] = true;
+
+        lock.unlock();
+        const Clock::time_point next = jobs_[timer.job].run();
+        lock.lock();
+
+        running_[timer.job] = false;
+        due_[timer.job] = next;
+        timers_.push({ next, timer.job, generations_[timer.job] });
+        cv_.notify_one();
+    }
+}
+
+bool JobScheduler::RunNow(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = std::find_if(jobs_.begin(), jobs_.end(), [&](const Job& job) { return job.name == name; });
+        if (it == jobs_.end() || workers_.empty())
+            return false;
+        const std::size_t job = static_cast<std::size_t>(it - jobs_.begin());
+        if (running_[job])
+            return false;
+        const Clock::time_point now = Clock::now();
+        due_[job] = now;
+        timers_.push({ now, job, ++generations_[job] });
+    }
+    cv_.notify_one();
+    return true;
+}
+
+std::vector<JobScheduler::JobStatus> JobScheduler::Status()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<JobStatus> status;
+    for (std::size_t i = 0; i < jobs_.size(); ++i)
+    {
+        const bool started = i < running_.size();
+        status.push_back({ jobs_[i].name, started && running_[i], started ? due_[i] : jobs_[i].first });
+    }
+    return status;
+}
@@ -0,0 +1,89 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs periodic jobs on a small pool of worker threads.
+// Pending runs sit in a min-heap ordered by due time. Idle workers sleep
+// until the earliest one is due, so the pool size is also the cap on how
+// many jobs run at once. A job is never run twice concurrently: its next
+// run is only queued once the current one returns, at the time the job
+// itself picks (see SchedulePolicy).
+class JobScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job
+    {
+        std::string name;
+        Clock::time_point first;
+        // Runs the job, returns when it should run again.
+        std::function<Clock::time_point()> run;
+    };
+
+    struct JobStatus
+    {
+        std::string name;
+        bool running;
+        // Meaningless while running.
+        Clock::time_point next;
+    };
+
+    // |max_concurrent| workers are started, fewer if there are fewer jobs.
+    explicit JobScheduler(std::size_t max_concurrent);
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    // Must be called before Start().
+    void Add(Job job);
+
+    void Start();
+    // Wakes idle workers and waits for running jobs to return.
+    void Stop();
+
+    // Moves the next run of job |name| to now. Returns false if there is no
+    // such job or it is running already.
+    bool RunNow(const std::string& name);
+
+    std::vector<JobStatus> Status();
+
+private:
+    struct Timer
+    {
+        Clock::time_point due;
+        std::size_t job;
+        // Timers of a job that was moved by RunNow() are stale and skipped.
+        uint64_t generation;
+
+        bool operator>(const Timer& other) const { return due > other.due; }
+    };
+
+    void Worker();
+
+    const std::size_t max_concurrent_;
+    std::vector<Job> jobs_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    // Per job, indexed like jobs_.
+    std::vector<uint64_t> generations_;
+    std::vector<Clock::time_point> due_;
+    std::vector<bool> running_;
+    bool stop_ = false;
+};
+
+#endif
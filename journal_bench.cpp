@@ -0,0 +1,199 @@
+// Measures lines per second through the Linux log path: the unbuffered
+// fprintf() to stderr WriteToEventLog() did before, which journald reads
+// as a stream, against JournalSink sending native journal datagrams, a line
+// at a time and in batches, and AsyncLogWriter in front of it as the
+// service uses it. journald is stood in for by a reader thread on a stream
+// socket pair and on a datagram socket in /tmp, each one counting what
+// arrives. Linux only.
+//
+//   journal_bench [lines] [line_size]
+
+#include "async_log_writer.h"
+#include "journal_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const std::size_t kBatch = 64;
+
+    // Reads and counts what arrives on |fd| until Stop(), lines on a stream
+    // socket and datagrams otherwise.
+    class Reader
+    {
+    public:
+        Reader(int fd, bool stream) : fd_(fd), stream_(stream)
+        {
+            // lets the thread notice Stop() while nothing arrives
+            timeval timeout{ 0, 100 * 1000 };
+            setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+            thread_ = std::thread(&Reader::Run, this);
+        }
+
+        ~Reader()
+        {
+            Stop();
+            close(fd_);
+        }
+
+        void Stop()
+        {
+            stop_ = true;
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+        // Waits until |count| messages have arrived, false if they stop
+        // coming first.
+        bool WaitFor(uint64_t count) const
+        {
+            uint64_t last = received_;
+            auto progress = Clock::now();
+            while (received_ < count)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+                if (received_ != last)
+                {
+                    last = received_;
+                    progress = Clock::now();
+                }
+                else if (Clock::now() - progress > std::chrono::seconds{ 2 })
+                    return false;
+            }
+            return true;
+        }
+
+        uint64_t Received() const { return received_; }
+        void Reset() { received_ = 0; }
+
+    private:
+        void Run()
+        {
+            std::vector<char> buffer(256 * 1024);
+            while (!stop_)
+            {
+                const ssize_t size = recv(fd_, buffer.data(), buffer.size(), 0);
+                if (size <= 0)
+                    continue;
+                if (!stream_)
+                {
+                    received_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                const uint64_t lines = static_cast<uint64_t>(std::count(buffer.data(), buffer.data() + size, '\n'));
+                received_.fetch_add(lines, std::memory_order_relaxed);
+            }
+        }
+
+        const int fd_;
+        const bool stream_;
+        std::atomic<bool> stop_{ false };
+        std::atomic<uint64_t> received_{ 0 };
+        std::thread thread_;
+    };
+
+    int bind_datagram(const std::string& path)
+    {
+        const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof address.sun_path - 1);
+        unlink(path.c_str());
+        if (fd == -1 || bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) == -1)
+        {
+            std::perror(path.c_str());
+            std::exit(1);
+        }
+        return fd;
+    }
+
+    void report(const char* name, std::size_t lines, Clock::duration elapsed, uint64_t received)
+    {
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        std::printf("  %-28s %10.0f lines/s  %7.2f us/line  received %llu/%zu\n", name, lines / seconds,
+                    seconds * 1e6 / lines, static_cast<unsigned long long>(received), lines);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const std::size_t line_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+    const std::string text(line_size, 'x');
+
+    std::printf("%zu lines of %zu bytes\n", lines, line_size);
+
+    // before: the stream journald attaches to stderr
+    {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1)
+        {
+            std::perror("socketpair");
+            return 1;
+        }
+        Reader reader(pair[0], true);
+        FILE* out = fdopen(pair[1], "w");
+        // stderr is unbuffered
+        setvbuf(out, nullptr, _IONBF, 0);
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < lines; ++i)
+            std::fprintf(out, "<%d>%s: %s\n", 6, "bench", text.c_str());
+        const auto elapsed = Clock::now() - start;
+        reader.WaitFor(lines);
+        report("before: fprintf(stderr)", lines, elapsed, reader.Received());
+        std::fclose(out);
+    }
+
+    const std::string path = "/tmp/journal_bench." + std::to_string(getpid()) + ".sock";
+    Reader reader(bind_datagram(path), false);
+
+    std::vector<LogSink::Line> batch(kBatch, LogSink::Line{ EVENTLOG_INFORMATION_TYPE, text });
+    for (const std::size_t size : { std::size_t{ 1 }, kBatch })
+    {
+        JournalSink sink(path);
+        sink.Open("bench");
+        reader.Reset();
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < lines; i += size)
+            sink.Write(batch.data(), std::min(size, lines - i));
+        const auto elapsed = Clock::now() - start;
+        reader.WaitFor(lines);
+        report(size == 1 ? "JournalSink, line at a time" : "JournalSink, batches of 64", lines, elapsed,
+               reader.Received());
+    }
+
+    // the caller's cost and the time until the sink has taken everything
+    {
+        reader.Reset();
+        AsyncLogWriter writer(std::unique_ptr<LogSink>(new JournalSink(path)), "bench", lines);
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < lines; ++i)
+            writer.Write(EVENTLOG_INFORMATION_TYPE, text);
+        const auto queued = Clock::now() - start;
+        writer.Flush(std::chrono::seconds{ 60 });
+        const auto written = Clock::now() - start;
+        reader.WaitFor(lines - writer.Dropped());
+        report("AsyncLogWriter, caller", lines, queued, reader.Received());
+        report("AsyncLogWriter, written", lines, written, reader.Received());
+        if (writer.Dropped() != 0)
+            std::printf("  %llu lines dropped, queue full\n", static_cast<unsigned long long>(writer.Dropped()));
+    }
+
+    reader.Stop();
+    unlink(path.c_str());
+    return 0;
+}
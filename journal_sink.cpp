@@ -0,0 +1,196 @@
+#include "journal_sink.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    const char kSyslogSocket[] = "/dev/log";
+    const std::size_t kMaxBatch = 64;
+
+    int syslog_priority(WORD type)
+    {
+        switch (type)
+        {
+        case EVENTLOG_ERROR_TYPE: return 3;
+        case EVENTLOG_WARNING_TYPE: return 4;
+        case EVENTLOG_INFORMATION_TYPE: return 6;
+        default: return 7;
+        }
+    }
+
+    int connect_unix(const char* path)
+    {
+        const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            return -1;
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path, sizeof address.sun_path - 1);
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) == -1)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
+
+JournalSink::JournalSink(const std::string& journal_socket)
+    : journal_socket_(journal_socket)
+{
+}
+
+JournalSink::~JournalSink()
+{
+    Close();
+}
+
+bool JournalSink::Open(const std::string& source)
+{
+    source_ = source;
+    return Connect();
+}
+
+bool JournalSink::Connect()
+{
+    Close();
+    fd_ = connect_unix(journal_socket_.c_str());
+    if (fd_ != -1)
+    {
+        mode_ = Mode::Journal;
+        return true;
+    }
+    fd_ = connect_unix(kSyslogSocket);
+    if (fd_ != -1)
+    {
+        mode_ = Mode::Syslog;
+        return true;
+    }
+    mode_ = Mode::Stderr;
+    return true;
+}
+
+void JournalSink::Close()
+{
+    if (fd_ != -1)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+void JournalSink::Format(const Line& line, std::string& out) const
+{
+    out.clear();
+    const int priority = syslog_priority(line.type);
+    if (mode_ == Mode::Syslog)
+    {
+        // RFC 3164 style, facility daemon
+        out += '<';
+        out += std::to_string(3 * 8 + priority);
+        out += '>';
+        out += source_;
+        out += ": ";
+        out += line.text;
+        return;
+    }
+
+    out += "PRIORITY=";
+    out += static_cast<char>('0' + priority);
+    out += "\nSYSLOG_IDENTIFIER=";
+    out += source_;
+    if (line.text.find('\n') == std::string::npos)
+    {
+        out += "\nMESSAGE=";
+        out += line.text;
+        out += '\n';
+        return;
+    }
+
+    // multi-line values are sent as name, newline, 64 bit little endian
+    // length and the raw bytes
+    out += "\nMESSAGE\n";
+    uint64_t size = line.text.size();
+    for (int i = 0; i < 8; ++i)
+        out += static_cast<char>((size >> (8 * i)) & 0xff);
+    out += line.text;
+    out += '\n';
+}
+
+std::size_t JournalSink::Send(std::size_t first, std::size_t last)
+{
+    iovec iov[kMaxBatch];
+    mmsghdr messages[kMaxBatch];
+    std::memset(messages, 0, sizeof messages);
+    for (std::size_t i = first; i < last; ++i)
+    {
+        iov[i].iov_base = &datagrams_[i][0];
+        iov[i].iov_len = datagrams_[i].size();
+        messages[i].msg_hdr.msg_iov = &iov[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::size_t sent = first;
+    while (sent < last)
+    {
+        const int result = sendmmsg(fd_, messages + sent, static_cast<unsigned>(last - sent), MSG_NOSIGNAL);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        sent += static_cast<std::size_t>(result);
+    }
+    return sent;
+}
+
+void JournalSink::Write(const Line* lines, std::size_t count)
+{
+    while (count != 0)
+    {
+        const std::size_t batch = count < kMaxBatch ? count : kMaxBatch;
+        if (datagrams_.size() < batch)
+            datagrams_.resize(batch);
+
+        std::size_t done = 0;
+        bool reconnected = false;
+        while (done < batch)
+        {
+            if (mode_ == Mode::Stderr)
+            {
+                WriteStderr(lines + done, batch - done);
+                break;
+            }
+            for (std::size_t i = done; i < batch; ++i)
+                Format(lines[i], datagrams_[i]);
+            done = Send(done, batch);
+            if (done == batch)
+                break;
+
+            // the log daemon might have been restarted, reconnect once
+            if (reconnected)
+            {
+                WriteStderr(lines + done, batch - done);
+                break;
+            }
+            reconnected = true;
+            Connect();
+        }
+        lines += batch;
+        count -= batch;
+    }
+}
+
+void JournalSink::WriteStderr(const Line* lines, std::size_t count) const
+{
+    // journald still picks the priority from the "<N>" prefix when stderr
+    // is connected to it
+    for (std::size_t i = 0; i < count; ++i)
+        std::fprintf(stderr, "<%d>%s: %s\n", syslog_priority(lines[i].type), source_.c_str(), lines[i].text.c_str());
+}
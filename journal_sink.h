@@ -0,0 +1,49 @@
+#ifndef JOURNAL_SINK_H
+#define JOURNAL_SINK_H
+
+#include <string>
+#include <vector>
+
+#include "log_sink.h"
+
+// Linux log sink. Lines go to journald over its native datagram protocol,
+// or to the syslog socket if there is no journal, or to stderr if neither
+// socket is there. A whole batch is sent with one sendmmsg() call over a
+// socket that stays connected.
+class JournalSink : public LogSink
+{
+public:
+    // |journal_socket| stands in for journald's socket, e.g. in benchmarks.
+    explicit JournalSink(const std::string& journal_socket = "/run/systemd/journal/socket");
+    ~JournalSink() override;
+
+    JournalSink(const JournalSink&) = delete;
+    JournalSink& operator=(const JournalSink&) = delete;
+
+    bool Open(const std::string& source) override;
+    void Write(const Line* lines, std::size_t count) override;
+
+private:
+    enum class Mode
+    {
+        Journal,
+        Syslog,
+        Stderr
+    };
+
+    bool Connect();
+    void Close();
+    void Format(const Line& line, std::string& out) const;
+    // Sends datagrams_[first, last), returns the index after the last sent.
+    std::size_t Send(std::size_t first, std::size_t last);
+    void WriteStderr(const Line* lines, std::size_t count) const;
+
+    const std::string journal_socket_;
+    std::string source_;
+    Mode mode_ = Mode::Stderr;
+    int fd_ = -1;
+    // Datagrams of the current batch, reused between batches.
+    std::vector<std::string> datagrams_;
+};
+
+#endif
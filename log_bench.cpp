@@ -0,0 +1,117 @@
+// Times draining a spooled backlog of log events, as left behind by a log
+// server outage, with different numbers of requests in flight. The server
+// is a StandInServer that takes |latency_ms| to answer each request.
+//
+//   log_bench [events] [latency_ms] [batch_size]
+
+#include "clef_writer.h"
+#include "http_client.h"
+#include "log_shipper.h"
+#include "log_spool.h"
+#include "stand_in_server.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    class BenchTransport : public LogShipper::Transport
+    {
+    public:
+        BenchTransport(const std::string& url, std::size_t max_in_flight)
+            : client_(url, std::string(), max_in_flight)
+        {
+        }
+
+        std::size_t Capacity() const override { return client_.Capacity(); }
+        bool Start(const std::string& body, uint64_t id) override { return client_.Start(body, id); }
+        void Poll(std::chrono::milliseconds timeout, std::vector<Result>& done) override
+        {
+            completions_.clear();
+            client_.Poll(timeout, completions_);
+            for (const auto& completion : completions_)
+                done.push_back({ completion.id, completion.ok });
+        }
+
+    private:
+        HttpClient client_;
+        std::vector<HttpClient::Completion> completions_;
+    };
+
+    void fill_spool(const LogSpool::Options& options, std::size_t count)
+    {
+        LogSpool spool(options);
+        if (!spool.Open())
+        {
+            std::fprintf(stderr, "cannot open %s\n", options.directory.c_str());
+            std::exit(1);
+        }
+        ClefWriter writer;
+        writer.Init("(windows_updater: {machine_name}) {msg}", "bench");
+        const std::string timestamp = "2024-01-01T00:00:00.000Z";
+        std::vector<std::string> events;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const LogRecord record("job{job}: next run at {next_run}", i % 8, "2024-01-01 00:05:00");
+            events.emplace_back();
+            writer.Append(events.back(), ClefWriter::Level::Debug, timestamp.data(), timestamp.size(),
+                          record.Data(), record.Size());
+            if (events.size() == 10000 || i + 1 == count)
+            {
+                spool.Append(events);
+                events.clear();
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    namespace fs = std::experimental::filesystem;
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::chrono::milliseconds latency{ argc > 2 ? std::atoi(argv[2]) : 2 };
+    const std::size_t batch_size = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 250;
+
+    HttpClient::GlobalInit();
+    std::printf("%zu events in batches of %zu, %lld ms per request\n", count, batch_size,
+                static_cast<long long>(latency.count()));
+
+    // outlives main(), its connection threads are detached
+    StandInServer& server = *new StandInServer(latency);
+    for (std::size_t in_flight : { 1, 4, 16 })
+    {
+        const uint64_t received = server.Events();
+        const uint64_t connections = server.Connections();
+        LogSpool::Options spool_options;
+        spool_options.directory = (fs::temp_directory_path() / "log_bench_spool").string();
+        spool_options.max_bytes = uint64_t{ 4 } << 30;
+        fs::remove_all(spool_options.directory);
+        fill_spool(spool_options, count);
+
+        auto spool = std::make_unique<LogSpool>(spool_options);
+        spool->Open();
+        LogShipper::Options options;
+        options.batch_size = batch_size;
+        options.max_in_flight = in_flight;
+        const std::string url = "http://127.0.0.1:" + std::to_string(server.Port()) + "/api/events/raw";
+        LogShipper shipper(options, ClefWriter(), std::make_unique<BenchTransport>(url, in_flight), std::move(spool));
+
+        const auto start = std::chrono::steady_clock::now();
+        shipper.Start();
+        while (server.Events() - received < count)
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        shipper.Stop();
+        fs::remove_all(spool_options.directory);
+
+        std::printf("  K=%-2zu %8.2f s  %10.0f events/s  %llu connections\n", in_flight, elapsed.count(),
+                    count / elapsed.count(), static_cast<unsigned long long>(server.Connections() - connections));
+    }
+
+    HttpClient::GlobalCleanup();
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "log_coalescer.h"
+
+#include <cstring>
+
+namespace
+{
+    const uint64_t kFnvOffset = 14695981039346656037ull;
+    const uint64_t kFnvPrime = 1099511628211ull;
+}
+
+LogCoalescer::LogCoalescer(std::size_t capacity, Clock::duration window)
+    : window_(window)
+{
+    if (capacity == 0 || window <= Clock::duration::zero())
+        return;
+    entries_.resize(capacity);
+    // chains stay short at half load
+    std::size_t buckets = 2;
+    while (buckets < capacity * 2)
+        buckets <<= 1;
+    buckets_.assign(buckets, 0);
+}
+
+LogCoalescer::Clock::time_point LogCoalescer::NextExpiry() const
+{
+    return count_ != 0 ? entries_[head_].expires : Clock::time_point::max();
+}
+
+//static
+uint64_t LogCoalescer::Hash(uint16_t level, const char* text, std::size_t size)
+{
+    // FNV-1a
+    uint64_t hash = (kFnvOffset ^ level) * kFnvPrime;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+bool LogCoalescer::Repeat(uint64_t hash, uint16_t level, const char* text, std::size_t size, Time time)
+{
+    for (uint32_t i = buckets_[hash & (buckets_.size() - 1)]; i != 0; i = entries_[i - 1].next)
+    {
+        Entry& entry = entries_[i - 1];
+        if (entry.hash != hash || entry.level != level || entry.text.size() != size
+            || std::memcmp(entry.text.data(), text, size) != 0)
+            continue;
+        if (entry.repeats++ == 0)
+            entry.first = time;
+        entry.last = time;
+        return true;
+    }
+    return false;
+}
+
+void LogCoalescer::Insert(uint64_t hash, uint16_t level, const char* text, std::size_t size, Clock::time_point now)
+{
+    const std::size_t index = (head_ + count_) % entries_.size();
+    ++count_;
+    Entry& entry = entries_[index];
+    entry.hash = hash;
+    entry.level = level;
+    // reuses the buffer of the entry's previous event
+    entry.text.assign(text, size);
+    entry.expires = now + window_;
+    entry.repeats = 0;
+    uint32_t& bucket = buckets_[hash & (buckets_.size() - 1)];
+    entry.next = bucket;
+    bucket = static_cast<uint32_t>(index + 1);
+}
+
+void LogCoalescer::PopFront()
+{
+    const Entry& oldest = entries_[head_];
+    // unlink it, it's the last in its chain unless a younger entry collided
+    uint32_t* link = &buckets_[oldest.hash & (buckets_.size() - 1)];
+    while (*link != head_ + 1)
+        link = &entries_[*link - 1].next;
+    *link = oldest.next;
+    head_ = (head_ + 1) % entries_.size();
+    --count_;
+}
@@ -0,0 +1,129 @@
+#ifndef LOG_COALESCER_H
+#define LOG_COALESCER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Folds repeats of an event into one summary.
+// The first occurrence of an event passes and opens a |window| for it,
+// further occurrences within the window are only counted. Once the window
+// closes, or the event is pushed out by newer ones, the repeats come out as
+// a single summary with their count and first and last time.
+// Events are told apart by level and text, e.g. an encoded LogRecord with
+// its template and values, through a hash table over at most |capacity| of
+// the most recent distinct events, so both the memory and the work per
+// event are bounded. Texts over kMaxText always pass.
+// Not thread safe.
+class LogCoalescer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Time = std::chrono::system_clock::time_point;
+
+    // The repeats of an event while its window was open.
+    struct Repeats
+    {
+        uint16_t level;
+        const std::string& text;
+        uint64_t count;
+        Time first;
+        Time last;
+    };
+
+    static const std::size_t kMaxText = 8192;
+
+    // A zero |capacity| or |window| lets everything through.
+    LogCoalescer(std::size_t capacity, Clock::duration window);
+
+    LogCoalescer(const LogCoalescer&) = delete;
+    LogCoalescer& operator=(const LogCoalescer&) = delete;
+
+    bool Enabled() const { return !entries_.empty(); }
+
+    // Whether the event logged at |time| and seen at |now| passes, false if
+    // it was counted as a repeat. Calls |emit| with the Repeats of closed
+    // windows first.
+    template <typename Emit>
+    bool Offer(uint16_t level, const char* text, std::size_t size, Time time, Clock::time_point now, Emit emit);
+
+    // Calls |emit| with the Repeats of windows closed by |now|.
+    template <typename Emit>
+    void Expire(Clock::time_point now, Emit emit);
+
+    // Calls |emit| with all Repeats, whether their window closed or not.
+    template <typename Emit>
+    void Flush(Emit emit) { Expire(Clock::time_point::max(), emit); }
+
+    // When the oldest window closes, max() if none is open.
+    Clock::time_point NextExpiry() const;
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        uint16_t level;
+        std::string text;
+        Clock::time_point expires;
+        uint64_t repeats;
+        Time first;
+        Time last;
+        // Index + 1 of the next entry in the same bucket, 0 ends the chain.
+        uint32_t next;
+    };
+
+    static uint64_t Hash(uint16_t level, const char* text, std::size_t size);
+    // Counts the event if its window is open, false if it has none.
+    bool Repeat(uint64_t hash, uint16_t level, const char* text, std::size_t size, Time time);
+    void Insert(uint64_t hash, uint16_t level, const char* text, std::size_t size, Clock::time_point now);
+    // Closes the oldest window.
+    void PopFront();
+    Entry& Front() { return entries_[head_]; }
+
+    const Clock::duration window_;
+    // Open windows oldest first, a circular buffer of |count_| entries from
+    // |head_|. Windows are all the same length, so the oldest closes first.
+    std::vector<Entry> entries_;
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    // Index + 1 of the first entry of each chain, 0 for none.
+    std::vector<uint32_t> buckets_;
+};
+
+template <typename Emit>
+bool LogCoalescer::Offer(uint16_t level, const char* text, std::size_t size, Time time, Clock::time_point now,
+                         Emit emit)
+{
+    if (!Enabled() || size > kMaxText)
+        return true;
+    Expire(now, emit);
+    const uint64_t hash = Hash(level, text, size);
+    if (Repeat(hash, level, text, size, time))
+        return false;
+    if (count_ == entries_.size())
+    {
+        // the oldest window closes early to make room
+        const Entry& oldest = Front();
+        if (oldest.repeats != 0)
+            emit(Repeats{ oldest.level, oldest.text, oldest.repeats, oldest.first, oldest.last });
+        PopFront();
+    }
+    Insert(hash, level, text, size, now);
+    return true;
+}
+
+template <typename Emit>
+void LogCoalescer::Expire(Clock::time_point now, Emit emit)
+{
+    while (count_ != 0 && Front().expires <= now)
+    {
+        const Entry& oldest = Front();
+        if (oldest.repeats != 0)
+            emit(Repeats{ oldest.level, oldest.text, oldest.repeats, oldest.first, oldest.last });
+        PopFront();
+    }
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include "log_record.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    // Bytes a value takes after its type.
+    std::size_t payload_size(const LogRecord::Value& value)
+    {
+        switch (value.type)
+        {
+        case LogRecord::Type::Bool: return 1;
+        case LogRecord::Type::String: return sizeof(uint32_t) + value.size;
+        default: return 8;
+        }
+    }
+
+    // Appends [at, end) of a template with {{ and }} unescaped.
+    void append_text(std::string& out, const char* at, const char* end)
+    {
+        while (at < end)
+        {
+            const char* brace = at;
+            while (brace < end && *brace != '{' && *brace != '}')
+                ++brace;
+            out.append(at, brace);
+            if (brace == end)
+                return;
+            out += *brace;
+            at = brace + (brace + 1 < end && brace[1] == *brace ? 2 : 1);
+        }
+    }
+
+    void append_value(std::string& out, const LogRecord::Value& value)
+    {
+        char number[32];
+        int size = 0;
+        switch (value.type)
+        {
+        case LogRecord::Type::Bool:
+            out += value.boolean ? "true" : "false";
+            return;
+        case LogRecord::Type::Int:
+            size = std::snprintf(number, sizeof number, "%lld", static_cast<long long>(value.integer));
+            break;
+        case LogRecord::Type::UInt:
+            size = std::snprintf(number, sizeof number, "%llu", static_cast<unsigned long long>(value.unsigned_integer));
+            break;
+        case LogRecord::Type::Double:
+            size = std::snprintf(number, sizeof number, "%.15g", value.number);
+            break;
+        case LogRecord::Type::String:
+            out.append(value.text, value.size);
+            return;
+        }
+        out.append(number, static_cast<std::size_t>(size));
+    }
+}
+
+LogRecord::Reader::Reader(const char* data, std::size_t size)
+    : template_("")
+    , at_(data)
+    , end_(data + size)
+{
+    if (size < sizeof template_)
+    {
+        at_ = end_;
+        return;
+    }
+    std::memcpy(&template_, at_, sizeof template_);
+    at_ += sizeof template_;
+}
+
+bool LogRecord::Reader::Next(Value& value)
+{
+    // a record cut short by the ring ends at the last complete value
+    if (end_ - at_ < 2)
+        return false;
+    value.type = static_cast<Type>(*at_);
+    const char* payload = at_ + 1;
+    const std::size_t left = static_cast<std::size_t>(end_ - payload);
+    switch (value.type)
+    {
+    case Type::Bool:
+        value.boolean = *payload != 0;
+        at_ = payload + 1;
+        return true;
+    case Type::Int:
+    case Type::UInt:
+    case Type::Double:
+        if (left < 8)
+            return false;
+        std::memcpy(&value.integer, payload, 8);
+        at_ = payload + 8;
+        return true;
+    case Type::String:
+    {
+        uint32_t size = 0;
+        if (left < sizeof size)
+            return false;
+        std::memcpy(&size, payload, sizeof size);
+        if (left - sizeof size < size)
+            return false;
+        value.text = payload + sizeof size;
+        value.size = size;
+        at_ = value.text + size;
+        return true;
+    }
+    }
+    return false;
+}
+
+//static
+LogRecord::Value LogRecord::Capture(bool value)
+{
+    Value captured;
+    captured.type = Type::Bool;
+    captured.boolean = value;
+    return captured;
+}
+
+//static
+LogRecord::Value LogRecord::Capture(double value)
+{
+    Value captured;
+    captured.type = Type::Double;
+    captured.number = value;
+    return captured;
+}
+
+//static
+LogRecord::Value LogRecord::Capture(const char* value)
+{
+    Value captured;
+    captured.type = Type::String;
+    captured.text = value ? value : "";
+    captured.size = std::strlen(captured.text);
+    return captured;
+}
+
+//static
+LogRecord::Value LogRecord::Capture(const std::string& value)
+{
+    Value captured;
+    captured.type = Type::String;
+    captured.text = value.data();
+    captured.size = value.size();
+    return captured;
+}
+
+void LogRecord::Init(const char* message_template, const Value* values, std::size_t count)
+{
+    size_ = sizeof message_template;
+    for (std::size_t i = 0; i < count; ++i)
+        size_ += 1 + payload_size(values[i]);
+    char* out = inline_;
+    if (size_ > kInlineSize)
+    {
+        heap_.resize(size_);
+        out = &heap_[0];
+    }
+    data_ = out;
+
+    std::memcpy(out, &message_template, sizeof message_template);
+    out += sizeof message_template;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Value& value = values[i];
+        *out++ = static_cast<char>(value.type);
+        switch (value.type)
+        {
+        case Type::Bool:
+            *out++ = value.boolean ? 1 : 0;
+            break;
+        case Type::String:
+        {
+            const auto size = static_cast<uint32_t>(value.size);
+            std::memcpy(out, &size, sizeof size);
+            std::memcpy(out + sizeof size, value.text, value.size);
+            out += sizeof size + value.size;
+            break;
+        }
+        default:
+            std::memcpy(out, &value.integer, 8);
+            out += 8;
+            break;
+        }
+    }
+}
+
+//static
+bool LogRecord::FindHole(const char* at, const char* end, Hole& hole)
+{
+    while (at < end)
+    {
+        if (*at != '{')
+        {
+            ++at;
+            continue;
+        }
+        if (at + 1 < end && at[1] == '{')
+        {
+            at += 2;
+            continue;
+        }
+        const char* close = static_cast<const char*>(std::memchr(at + 1, '}', static_cast<std::size_t>(end - at - 1)));
+        if (!close)
+            return false;
+        const char* name = at + 1;
+        if (name < close && (*name == '@' || *name == '$'))
+            ++name;
+        const char* name_end = name;
+        while (name_end < close && (std::isalnum(static_cast<unsigned char>(*name_end)) || *name_end == '_'))
+            ++name_end;
+        if (name_end != name && (name_end == close || *name_end == ',' || *name_end == ':'))
+        {
+            hole.begin = at;
+            hole.end = close + 1;
+            hole.name = name;
+            hole.name_size = static_cast<std::size_t>(name_end - name);
+            return true;
+        }
+        // not a hole, e.g. JSON in the text
+        at = close + 1;
+    }
+    return false;
+}
+
+//static
+void LogRecord::Render(std::string& out, const char* data, std::size_t size)
+{
+    Reader reader(data, size);
+    const char* at = reader.Template();
+    const char* end = at + std::strlen(at);
+    Hole hole;
+    Value value;
+    while (FindHole(at, end, hole))
+    {
+        append_text(out, at, hole.begin);
+        if (reader.Next(value))
+            append_value(out, value);
+        else
+            out.append(hole.begin, hole.end);
+        at = hole.end;
+    }
+    append_text(out, at, end);
+}
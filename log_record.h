@@ -0,0 +1,127 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// A log event captured for formatting on another thread: a message template
+// and the values of its holes, copied into one compact binary record.
+// Holes are bound to the values in order, as in
+//   LogRecord record("{job}: updater exited with {code}", job.name, 3);
+// which keeps the job name as a string and the code as an integer. Only the
+// template's address is kept, it has to be a string literal.
+// Capturing doesn't allocate unless the record outgrows kInlineSize.
+class LogRecord
+{
+public:
+    enum class Type : unsigned char
+    {
+        Bool,
+        Int,
+        UInt,
+        Double,
+        String
+    };
+
+    struct Value
+    {
+        Type type;
+        union
+        {
+            bool boolean;
+            int64_t integer;
+            uint64_t unsigned_integer;
+            double number;
+        };
+        // String only, not terminated.
+        const char* text;
+        std::size_t size;
+    };
+
+    // A {name} placeholder in a message template. {@name}, {$name} and
+    // format or alignment suffixes are accepted, only the name is kept.
+    struct Hole
+    {
+        const char* begin;
+        const char* end;
+        const char* name;
+        std::size_t name_size;
+    };
+
+    // Walks the template and values of an encoded record, which stays owned
+    // by the caller.
+    class Reader
+    {
+    public:
+        Reader(const char* data, std::size_t size);
+
+        const char* Template() const { return template_; }
+        // False after the last value.
+        bool Next(Value& value);
+
+    private:
+        const char* template_;
+        const char* at_;
+        const char* end_;
+    };
+
+    static const std::size_t kInlineSize = 224;
+
+    template <typename... Args>
+    explicit LogRecord(const char* message_template, const Args&... args)
+    {
+        // one more so an empty pack still makes an array
+        const Value values[] = { Capture(args)..., Value() };
+        Init(message_template, values, sizeof...(Args));
+    }
+
+    LogRecord(const LogRecord&) = delete;
+    LogRecord& operator=(const LogRecord&) = delete;
+
+    const char* Data() const { return data_; }
+    std::size_t Size() const { return size_; }
+
+    // Finds the first hole in [at, end), false if there is none. Escaped
+    // braces, {{ and }}, are text.
+    static bool FindHole(const char* at, const char* end, Hole& hole);
+
+    // Appends the message with the holes filled in, for plain text logs.
+    static void Render(std::string& out, const char* data, std::size_t size);
+
+private:
+    static Value Capture(bool value);
+    static Value Capture(double value);
+    static Value Capture(const char* value);
+    static Value Capture(const std::string& value);
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, Value>::type
+    Capture(T value)
+    {
+        Value captured;
+        captured.type = Type::Int;
+        captured.integer = value;
+        return captured;
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, Value>::type
+    Capture(T value)
+    {
+        Value captured;
+        captured.type = Type::UInt;
+        captured.unsigned_integer = value;
+        return captured;
+    }
+
+    void Init(const char* message_template, const Value* values, std::size_t count);
+
+    char inline_[kInlineSize];
+    std::string heap_;
+    const char* data_;
+    std::size_t size_;
+};
+
+#endif
@@ -0,0 +1,209 @@
+// Times what UpdaterService::Log() costs the calling thread for a few of
+// the service's messages: building the message string first and logging
+// that, as the service did before, against capturing a LogRecord and
+// leaving the formatting to the log threads. Either way the event goes to
+// an AsyncLogWriter and a LogShipper, whose sink and transport discard it.
+// With fewer cores than threads the log threads preempt the caller in the
+// middle of a call, so building the string and capturing the record are
+// also timed alone. Calls come in bursts of 256. Latencies include two
+// clock reads.
+//
+//   log_record_bench [calls per message]
+
+#include "async_log_writer.h"
+#include "clef_writer.h"
+#include "log_record.h"
+#include "log_shipper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    class NullSink : public LogSink
+    {
+    public:
+        bool Open(const std::string&) override { return true; }
+        void Write(const Line* /*lines*/, std::size_t /*count*/) override {}
+    };
+
+    class NullTransport : public LogShipper::Transport
+    {
+    public:
+        std::size_t Capacity() const override { return 4; }
+        bool Start(const std::string& /*body*/, uint64_t id) override
+        {
+            started_.push_back(id);
+            return true;
+        }
+        void Poll(std::chrono::milliseconds /*timeout*/, std::vector<Result>& done) override
+        {
+            for (uint64_t id : started_)
+                done.push_back({ id, true });
+            started_.clear();
+        }
+
+    private:
+        std::vector<uint64_t> started_;
+    };
+
+    // The service's two log destinations.
+    struct Destinations
+    {
+        Destinations()
+            : writer(std::make_unique<NullSink>(), "bench")
+            , shipper(Options(), Writer(), std::make_unique<NullTransport>())
+        {
+            shipper.Start();
+        }
+
+        static LogShipper::Options Options()
+        {
+            LogShipper::Options options;
+            options.queue_capacity = 4096;
+            options.batch_size = 500;
+            options.linger = std::chrono::milliseconds{ 10 };
+            return options;
+        }
+
+        static ClefWriter Writer()
+        {
+            ClefWriter writer;
+            writer.Init("(windows_updater: {machine_name}) {msg}", "bench");
+            return writer;
+        }
+
+        AsyncLogWriter writer;
+        LogShipper shipper;
+    };
+
+    // The message as a string, logged the way Log(const std::string&) does.
+    void log_string(Destinations& to, const std::string& message)
+    {
+        to.writer.Write(EVENTLOG_ERROR_TYPE, message);
+        to.shipper.Enqueue(LogShipper::Level::Error, LogRecord("{msg}", message));
+    }
+
+    template <typename... Args>
+    void log_record(Destinations& to, const char* message_template, const Args&... args)
+    {
+        const LogRecord record(message_template, args...);
+        to.writer.Write(EVENTLOG_ERROR_TYPE, record);
+        to.shipper.Enqueue(LogShipper::Level::Error, record);
+    }
+
+    // Keeps the optimizer from dropping the work done without logging.
+    volatile std::size_t g_sizes = 0;
+
+    void report(const char* name, std::vector<uint32_t>& samples, uint64_t dropped)
+    {
+        double total = 0;
+        for (uint32_t sample : samples)
+            total += sample;
+        std::sort(samples.begin(), samples.end());
+        const auto at = [&](double quantile) {
+            return static_cast<unsigned>(samples[std::min(samples.size() - 1, static_cast<std::size_t>(quantile * samples.size()))]);
+        };
+        std::printf("  %-22s mean %6.0f  p50 %6u  p90 %6u  p99 %7u ns  dropped %llu\n", name, total / samples.size(),
+                    at(0.5), at(0.9), at(0.99), static_cast<unsigned long long>(dropped));
+    }
+
+    template <typename Call>
+    void time_calls(std::vector<uint32_t>& samples, std::size_t calls, Call call)
+    {
+        samples.clear();
+        samples.reserve(calls);
+        for (std::size_t i = 0; i < calls; ++i)
+        {
+            const auto before = Clock::now();
+            call();
+            const auto after = Clock::now();
+            samples.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+            // let the log threads keep up, only the calls are timed
+            if (i % 256 == 255)
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+        }
+    }
+
+    // |format| builds the message string, |capture| the LogRecord, both
+    // return the size so the result is used.
+    template <typename Format, typename Capture, typename Log>
+    void run(const char* name, std::size_t calls, Format format, Capture capture, Log log)
+    {
+        std::printf("%s\n", name);
+        std::vector<uint32_t> samples;
+        time_calls(samples, calls, [&] { g_sizes += format(); });
+        report("string, built only", samples, 0);
+        time_calls(samples, calls, [&] { g_sizes += capture(); });
+        report("record, captured only", samples, 0);
+
+        for (bool record : { false, true })
+        {
+            Destinations to;
+            time_calls(samples, calls, [&] { log(to, record); });
+            to.shipper.Stop();
+            report(record ? "record, logged" : "string, logged", samples,
+                   to.writer.Dropped() + to.shipper.GetStats().dropped);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::printf("%zu calls per message\n", calls);
+
+    const std::string job = "miner";
+    const unsigned long error = 1326;
+    const auto launch_error = [&] { return job + ": error while launching updater: " + std::to_string(error); };
+    run("launch error", calls,
+        [&] { return launch_error().size(); },
+        [&] { return LogRecord("{job}: error while launching updater: {error}", job, error).Size(); },
+        [&](Destinations& to, bool record) {
+            if (record)
+                log_record(to, "{job}: error while launching updater: {error}", job, error);
+            else
+                log_string(to, launch_error());
+        });
+
+    const std::string heartbeat = "miner";
+    const char* stage = "wait for updater";
+    const long long overdue = 61234;
+    const auto stall = [&] {
+        return heartbeat + ": stalled in " + stage + ", " + std::to_string(overdue) + " ms past its deadline";
+    };
+    run("stall", calls,
+        [&] { return stall().size(); },
+        [&] {
+            return LogRecord("{heartbeat}: stalled in {stage}, {overdue_ms} ms past its deadline", heartbeat, stage,
+                             overdue).Size();
+        },
+        [&](Destinations& to, bool record) {
+            if (record)
+                log_record(to, "{heartbeat}: stalled in {stage}, {overdue_ms} ms past its deadline", heartbeat, stage,
+                           overdue);
+            else
+                log_string(to, stall());
+        });
+
+    // an updater failing on an unreachable feed
+    const std::string output(600, 'x');
+    run("program output, 600 bytes", calls,
+        [&] { return ("Program output: " + output).size(); },
+        [&] { return LogRecord("Program output: {output}", output).Size(); },
+        [&](Destinations& to, bool record) {
+            if (record)
+                log_record(to, "Program output: {output}", output);
+            else
+                log_string(to, "Program output: " + output);
+        });
+    return 0;
+}
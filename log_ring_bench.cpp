@@ -0,0 +1,177 @@
+// Times Write() on the service log front end with 1, 4 and 16 threads
+// logging at once: AsyncLogWriter on its lock-free ring against the mutex
+// guarded queue it used before, copied below. The sink discards the lines,
+// so what is measured is the hand-off alone. Threads write in bursts of 256
+// lines. Latencies include two clock reads.
+//
+//   log_ring_bench [lines per thread]
+
+#include "async_log_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    class NullSink : public LogSink
+    {
+    public:
+        bool Open(const std::string&) override { return true; }
+        void Write(const Line* /*lines*/, std::size_t count) override { written_ += count; }
+
+    private:
+        uint64_t written_ = 0;
+    };
+
+    // AsyncLogWriter's queue before the ring.
+    class MutexQueueWriter
+    {
+    public:
+        explicit MutexQueueWriter(std::size_t capacity)
+            : capacity_(capacity)
+        {
+            thread_ = std::thread(&MutexQueueWriter::Run, this);
+        }
+
+        ~MutexQueueWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_one();
+            thread_.join();
+        }
+
+        void Write(WORD type, const std::string& text)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (queued_ >= capacity_)
+                {
+                    ++dropped_;
+                    return;
+                }
+                if (queued_ == queue_.size())
+                    queue_.push_back({ type, text });
+                else
+                {
+                    queue_[queued_].type = type;
+                    queue_[queued_].text.assign(text);
+                }
+                if (queued_++ != 0)
+                    return;
+            }
+            cv_.notify_one();
+        }
+
+        uint64_t Dropped() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return dropped_;
+        }
+
+    private:
+        void Run()
+        {
+            std::vector<LogSink::Line> batch;
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true)
+            {
+                cv_.wait(lock, [this] { return stop_ || queued_ != 0; });
+                if (queued_ == 0)
+                    break;
+                batch.swap(queue_);
+                const std::size_t count = queued_;
+                queued_ = 0;
+                lock.unlock();
+                sink_.Write(batch.data(), count);
+                lock.lock();
+            }
+        }
+
+        NullSink sink_;
+        const std::size_t capacity_;
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<LogSink::Line> queue_;
+        std::size_t queued_ = 0;
+        uint64_t dropped_ = 0;
+        bool stop_ = false;
+        std::thread thread_;
+    };
+
+    template <typename Writer>
+    void run(const char* name, Writer& writer, std::size_t threads, std::size_t lines)
+    {
+        std::vector<std::vector<uint32_t>> latencies(threads);
+        std::vector<std::thread> producers;
+        std::atomic<std::size_t> ready{ 0 };
+        const auto start = Clock::now();
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            producers.emplace_back([&, t] {
+                std::vector<uint32_t>& samples = latencies[t];
+                samples.reserve(lines);
+                const std::string text = "job" + std::to_string(t) + ": next run at 2026-10-18T03:45:45.002456Z";
+                ++ready;
+                while (ready != threads)
+                    std::this_thread::yield();
+                for (std::size_t i = 0; i < lines; ++i)
+                {
+                    const auto before = Clock::now();
+                    writer.Write(EVENTLOG_INFORMATION_TYPE, text);
+                    const auto after = Clock::now();
+                    samples.push_back(static_cast<uint32_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+                    // bursts rather than a flood the consumer can never
+                    // catch up with, which would only time dropping
+                    if (i % 256 == 255)
+                        std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& producer : producers)
+            producer.join();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        std::vector<uint32_t> all;
+        for (const auto& samples : latencies)
+            all.insert(all.end(), samples.begin(), samples.end());
+        std::sort(all.begin(), all.end());
+        const auto at = [&](double quantile) {
+            return static_cast<unsigned>(all[std::min(all.size() - 1, static_cast<std::size_t>(quantile * all.size()))]);
+        };
+        std::printf("  %-11s %2zu threads  p50 %6u  p90 %6u  p99 %7u  p99.9 %8u  max %9u ns  %6.2f M lines/s  dropped %llu\n",
+                    name, threads, at(0.5), at(0.9), at(0.99), at(0.999), all.back(),
+                    all.size() / elapsed.count() / 1e6, static_cast<unsigned long long>(writer.Dropped()));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::printf("%zu lines per thread, %u hardware threads\n", lines, std::thread::hardware_concurrency());
+    for (std::size_t threads : { 1, 4, 16 })
+    {
+        {
+            MutexQueueWriter writer(4096);
+            run("mutex queue", writer, threads, lines);
+        }
+        {
+            AsyncLogWriter writer(std::make_unique<NullSink>(), "bench", 4096);
+            run("ring", writer, threads, lines);
+        }
+    }
+    return 0;
+}
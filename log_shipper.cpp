@@ -0,0 +1,534 @@
+#include "log_shipper.h"
+
+#include <algorithm>
+
+#include "host_clock.h"
+
+namespace
+{
+    // How long the worker leaves the queue unchecked while requests are in
+    // flight, it can't wait for the transport and the queue at once.
+    const std::chrono::milliseconds kPollInterval{ 20 };
+}
+
+LogShipper::LogShipper(const Options& options, const ClefWriter& writer, std::unique_ptr<Transport> transport,
+                       std::unique_ptr<LogSpool> spool)
+    : options_(options)
+    , writer_(writer)
+    , ring_(options.queue_capacity)
+    , coalescer_(options.coalesce_capacity, options.coalesce_window)
+    , transport_(std::move(transport))
+    , spool_(std::move(spool))
+{
+    if (options_.gzip && GzipWriter::Available())
+        gzip_ = std::make_unique<GzipWriter>(options_.gzip_level);
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Level::Count); ++i)
+        rate_limits_[i].Reset(options_.rate_limit[i], options_.rate_limit[i]);
+}
+
+LogShipper::~LogShipper()
+{
+    Stop();
+}
+
+void LogShipper::Start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable() || !transport_)
+        return;
+    stop_ = false;
+    thread_ = std::thread(&LogShipper::Run, this);
+}
+
+void LogShipper::Stop()
+{
+    // a second caller waits for the first to finish instead of racing it
+    // for the thread and the transport
+    std::lock_guard<std::mutex> stopping(stop_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    room_cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+    transport_.reset();
+}
+
+bool LogShipper::Enqueue(Level level, const char* record, std::size_t size)
+{
+    TokenBucket& rate_limit = rate_limits_[static_cast<std::size_t>(level)];
+    if (!rate_limit.Unlimited() && !rate_limit.Take(Clock::now()))
+    {
+        rate_limited_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const auto time = std::chrono::system_clock::now();
+    Clock::time_point deadline;
+    std::size_t queued = 0;
+    while (!ring_.TryPush(static_cast<uint16_t>(level), time, record, size, &queued))
+    {
+        if (options_.overflow == Overflow::Block && deadline == Clock::time_point())
+        {
+            blocked_.fetch_add(1, std::memory_order_relaxed);
+            deadline = Clock::now() + options_.block_timeout;
+        }
+        if (options_.overflow != Overflow::Block || !WaitForRoom(deadline))
+        {
+            ring_full_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    // either the worker sees the event in Size() before going to sleep or
+    // this sees it asleep, and only the first caller to see it wakes it
+    const std::size_t wake_at = wake_at_.load(std::memory_order_seq_cst);
+    if (wake_at != 0 && queued >= wake_at && wake_at_.exchange(0, std::memory_order_seq_cst) != 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+    return true;
+}
+
+bool LogShipper::WaitForRoom(Clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++blocked_callers_;
+    // don't hold up shutdown
+    const bool room = room_cv_.wait_until(lock, deadline, [this] {
+        return stop_ || ring_.Size() < ring_.Capacity();
+    });
+    --blocked_callers_;
+    return room && !stop_;
+}
+
+void LogShipper::Take()
+{
+    std::size_t room = ring_.Capacity();
+    if (options_.overflow == Overflow::Block)
+    {
+        // events wait in the ring, holding up Enqueue() once it's full too
+        room = options_.queue_capacity > queue_.size() ? options_.queue_capacity - queue_.size() : 0;
+    }
+    const auto now = Clock::now();
+    const std::size_t taken = ring_.Drain(room, [&](const EventRing::Event& event) { Admit(event, now); });
+    if (taken != 0 && blocked_callers_ != 0)
+        room_cv_.notify_all();
+    coalescer_.Expire(now, [this](const LogCoalescer::Repeats& repeats) { AdmitRepeats(repeats); });
+}
+
+void LogShipper::Admit(const EventRing::Event& event, Clock::time_point now)
+{
+    if (!coalescer_.Offer(event.level, event.text, event.size, event.time, now,
+                          [this](const LogCoalescer::Repeats& repeats) { AdmitRepeats(repeats); }))
+    {
+        ++stats_.coalesced;
+        return;
+    }
+
+    const auto level = static_cast<Level>(event.level);
+    std::string* text = Push(level);
+    if (!text)
+        return;
+    char timestamp[kTimestampSize];
+    const std::size_t timestamp_size = format_timestamp(timestamp, event.time);
+    writer_.Append(*text, level, timestamp, timestamp_size, event.text, event.size);
+}
+
+void LogShipper::AdmitRepeats(const LogCoalescer::Repeats& repeats)
+{
+    const auto level = static_cast<Level>(repeats.level);
+    std::string* text = Push(level);
+    if (!text)
+        return;
+    char first[kTimestampSize];
+    char last[kTimestampSize];
+    const std::size_t timestamp_size = format_timestamp(first, repeats.first);
+    format_timestamp(last, repeats.last);
+    writer_.AppendRepeats(*text, level, repeats.text.data(), repeats.text.size(), repeats.count, first, last,
+                          timestamp_size);
+}
+
+std::string* LogShipper::Push(Level level)
+{
+    if (queue_.size() >= options_.queue_capacity && !MakeRoom(level))
+    {
+        ++stats_.dropped;
+        return nullptr;
+    }
+
+    std::string text;
+    if (!free_.empty())
+    {
+        text = std::move(free_.back());
+        free_.pop_back();
+        text.clear();
+    }
+    queue_.push_back({ std::move(text), level });
+    if (level == Level::Debug)
+        ++queued_debug_;
+    return &queue_.back().event;
+}
+
+bool LogShipper::MakeRoom(Level level)
+{
+    switch (options_.overflow)
+    {
+    case Overflow::DropOldest:
+        PopFront();
+        ++stats_.dropped;
+        return true;
+    case Overflow::DropDebugFirst:
+    {
+        if (level == Level::Debug || queued_debug_ == 0)
+            return false;
+        const auto it = std::find_if(queue_.begin(), queue_.end(),
+                                     [](const Queued& queued) { return queued.level == Level::Debug; });
+        if (free_.size() < options_.queue_capacity)
+            free_.push_back(std::move(it->event));
+        queue_.erase(it);
+        --queued_debug_;
+        ++stats_.dropped;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void LogShipper::PopFront()
+{
+    if (queue_.front().level == Level::Debug)
+        --queued_debug_;
+    if (free_.size() < options_.queue_capacity)
+        free_.push_back(std::move(queue_.front().event));
+    queue_.pop_front();
+}
+
+void LogShipper::Flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_ = true;
+    }
+    cv_.notify_one();
+}
+
+LogShipper::Stats LogShipper::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.dropped += ring_full_.load(std::memory_order_relaxed);
+    stats.rate_limited = rate_limited_.load(std::memory_order_relaxed);
+    stats.blocked = blocked_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void LogShipper::Run()
+{
+    const std::size_t batch_size = std::max<std::size_t>(options_.batch_size, 1);
+    const auto has_work = [this] { return stop_ || flush_ || !queue_.empty() || ring_.Size() != 0; };
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        Take();
+        if (!has_work())
+        {
+            if (ReplayDue() && HasRoom())
+            {
+                lock.unlock();
+                Replay();
+                lock.lock();
+            }
+            // until there is work, a request finishes or spooled events are
+            // due for another try
+            const bool retry_pending = spool_ && !spool_->Empty() && Clock::now() < retry_at_;
+            Wait(lock, std::min(retry_pending ? retry_at_ : Clock::time_point::max(), coalescer_.NextExpiry()), 1,
+                 has_work);
+            Take();
+        }
+
+        if (flush_)
+        {
+            retry_at_ = Clock::now();
+            if (queue_.empty())
+                flush_ = false;
+        }
+
+        if (queue_.empty())
+        {
+            if (ring_.Size() != 0)
+            {
+                // claimed but still being copied in
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+                continue;
+            }
+            if (!stop_)
+                continue;
+            // repeats of windows still open go out too
+            coalescer_.Flush([this](const LogCoalescer::Repeats& repeats) { AdmitRepeats(repeats); });
+            if (!queue_.empty())
+                continue;
+            lock.unlock();
+            while (!sending_.empty() || !replaying_.empty())
+                Poll(kPollInterval);
+            break;
+        }
+
+        // give the batch a chance to fill up before posting it
+        const auto deadline = Clock::now() + options_.linger;
+        const auto full = [&] { return stop_ || flush_ || queue_.size() + ring_.Size() >= batch_size; };
+        while (!full() && Clock::now() < deadline)
+        {
+            Wait(lock, deadline, batch_size - queue_.size(), full);
+            Take();
+        }
+        Take();
+
+        bool spill = false;
+        while (!HasRoom() && !(spill = SpillDue()))
+        {
+            lock.unlock();
+            Poll(kPollInterval);
+            lock.lock();
+            Take();
+        }
+
+        // a spill takes everything, the disk absorbs it in one write
+        std::vector<std::string> batch;
+        const std::size_t count = spill ? queue_.size() : std::min(batch_size, queue_.size());
+        batch.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (queue_.front().level == Level::Debug)
+                --queued_debug_;
+            batch.push_back(std::move(queue_.front().event));
+            queue_.pop_front();
+        }
+        if (spill)
+            stats_.spilled += count;
+        // refill what was taken, the ring may be holding up callers
+        Take();
+
+        lock.unlock();
+        if (spill)
+        {
+            // replayed once requests finish, everything queued after it
+            // follows through the spool to keep the order
+            spool_->Append(batch);
+        }
+        else
+        {
+            Deliver(std::move(batch));
+        }
+        if (ReplayDue())
+            Replay();
+        lock.lock();
+    }
+}
+
+bool LogShipper::Stopping() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stop_;
+}
+
+template <typename Ready>
+void LogShipper::Wait(std::unique_lock<std::mutex>& lock, Clock::time_point deadline, std::size_t wake_at, Ready ready)
+{
+    if (sending_.empty() && replaying_.empty())
+    {
+        // re-armed after every wakeup, Enqueue() disarms it when it notifies
+        while (true)
+        {
+            wake_at_.store(std::max<std::size_t>(wake_at, 1), std::memory_order_seq_cst);
+            if (ready())
+                break;
+            if (deadline == Clock::time_point::max())
+                cv_.wait(lock);
+            else if (cv_.wait_until(lock, deadline) == std::cv_status::timeout)
+                break;
+        }
+        wake_at_.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    while (!ready())
+    {
+        const auto now = Clock::now();
+        if (now >= deadline)
+            return;
+        const auto timeout = std::min<Clock::duration>(deadline - now, kPollInterval);
+        lock.unlock();
+        const bool finished = Poll(std::chrono::duration_cast<std::chrono::milliseconds>(timeout));
+        lock.lock();
+        if (finished)
+            return;
+    }
+}
+
+bool LogShipper::HasRoom() const
+{
+    const std::size_t capacity = std::max<std::size_t>(std::min(options_.max_in_flight, transport_->Capacity()), 1);
+    return sending_.size() + replaying_.size() < capacity;
+}
+
+bool LogShipper::SpillDue() const
+{
+    return options_.overflow == Overflow::Spill && spool_ && queue_.size() * 2 >= options_.queue_capacity;
+}
+
+bool LogShipper::ReplayDue() const
+{
+    return spool_ && !spool_->Empty() && !replay_failed_ && Clock::now() >= retry_at_;
+}
+
+void LogShipper::Deliver(std::vector<std::string>&& events)
+{
+    if (spool_ && (!spool_->Empty() || !replaying_.empty()))
+    {
+        // older events are still waiting on disk, keep the order
+        spool_->Append(events);
+        return;
+    }
+    Post(std::move(events), false);
+}
+
+void LogShipper::Replay()
+{
+    const std::size_t batch_size = std::max<std::size_t>(options_.batch_size, 1);
+    std::vector<std::string> events;
+    while (HasRoom() && !replay_failed_ && !Stopping() && spool_->Peek(batch_size, events) != 0)
+        Post(std::move(events), true);
+}
+
+void LogShipper::Post(std::vector<std::string>&& events, bool spooled)
+{
+    static const char kHead[] = "{\"Events\":[";
+    static const char kTail[] = "]}";
+
+    std::deque<Batch>& batches = spooled ? replaying_ : sending_;
+    batches.push_back({ ++next_id_, std::move(events), false, false });
+    const Batch& batch = batches.back();
+
+    const auto start = Clock::now();
+    const std::string* body = &body_;
+    uint64_t raw_bytes = 0;
+    bool ok = true;
+    if (gzip_)
+    {
+        ok = gzip_->Reset() && gzip_->Write(kHead, sizeof kHead - 1);
+        for (std::size_t i = 0; ok && i < batch.events.size(); ++i)
+        {
+            if (i != 0)
+                ok = gzip_->Write(",", 1);
+            ok = ok && gzip_->Write(batch.events[i]);
+        }
+        ok = ok && gzip_->Write(kTail, sizeof kTail - 1) && gzip_->Finish();
+        raw_bytes = gzip_->BytesIn();
+        body = &gzip_->Output();
+    }
+    else
+    {
+        body_.clear();
+        body_ += kHead;
+        for (std::size_t i = 0; i < batch.events.size(); ++i)
+        {
+            if (i != 0)
+                body_ += ',';
+            body_ += batch.events[i];
+        }
+        body_ += kTail;
+        raw_bytes = body_.size();
+    }
+    const auto elapsed = Clock::now() - start;
+
+    if (ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.batches;
+        stats_.events += batch.events.size();
+        stats_.raw_bytes += raw_bytes;
+        stats_.sent_bytes += body->size();
+        if (gzip_)
+            stats_.compress_time += std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+    }
+
+    // the transport copies the body, the buffer is free for the next one
+    if (!ok || !transport_->Start(*body, batch.id))
+    {
+        batches.back().done = true;
+        Settle();
+    }
+}
+
+bool LogShipper::Poll(std::chrono::milliseconds timeout)
+{
+    results_.clear();
+    transport_->Poll(timeout, results_);
+    for (const auto& result : results_)
+    {
+        for (auto* batches : { &sending_, &replaying_ })
+        {
+            const auto it = std::find_if(batches->begin(), batches->end(),
+                                         [&](const Batch& batch) { return batch.id == result.id; });
+            if (it != batches->end())
+            {
+                it->done = true;
+                it->ok = result.ok;
+            }
+        }
+    }
+    Settle();
+    return !results_.empty();
+}
+
+void LogShipper::Settle()
+{
+    for (auto it = sending_.begin(); it != sending_.end();)
+    {
+        if (!it->done)
+        {
+            ++it;
+            continue;
+        }
+        if (!it->ok && spool_)
+        {
+            spool_->Append(it->events);
+            retry_at_ = Clock::now() + options_.retry_interval;
+        }
+        for (auto& e : it->events)
+        {
+            if (free_.size() >= options_.queue_capacity)
+                break;
+            free_.push_back(std::move(e));
+        }
+        it = sending_.erase(it);
+    }
+
+    // spooled events leave the disk strictly in order, nothing read after a
+    // failed batch is committed
+    while (!replaying_.empty() && replaying_.front().done)
+    {
+        if (replaying_.front().ok && !replay_failed_)
+        {
+            spool_->Commit();
+        }
+        else if (!replay_failed_)
+        {
+            replay_failed_ = true;
+            retry_at_ = Clock::now() + options_.retry_interval;
+        }
+        replaying_.pop_front();
+    }
+    if (replay_failed_ && replaying_.empty())
+    {
+        spool_->Rewind();
+        replay_failed_ = false;
+    }
+}
@@ -0,0 +1,253 @@
+#ifndef LOG_SHIPPER_H
+#define LOG_SHIPPER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clef_writer.h"
+#include "event_ring.h"
+#include "gzip_writer.h"
+#include "log_coalescer.h"
+#include "log_record.h"
+#include "log_spool.h"
+#include "token_bucket.h"
+
+// Ships log events to the log server in batches.
+// Enqueue() copies the LogRecord into a lock-free ring and returns, one
+// long-lived background thread serializes the events and posts up to
+// |batch_size| of them per request, or whatever has accumulated after
+// |linger| has passed since the first queued event.
+// Up to |max_in_flight| requests run at once, so a backlog drains at the
+// server's pace rather than one round trip per batch. Batches that can't be
+// delivered go to the optional on-disk spool and are replayed every
+// |retry_interval| until the server takes them; spooled events are only
+// dropped from disk once delivered, in order. With several requests in
+// flight the server can receive batches out of order.
+// With |gzip| set request bodies are compressed while they are assembled.
+// Callers are kept from flooding the pipeline by a per level rate limit and
+// by the |overflow| policy once |queue_capacity| events are waiting; the
+// ring in front of the queue holds another |queue_capacity| at most.
+// With a |coalesce_window| an event repeated within the window is shipped
+// once, followed by one event with the RepeatCount once the window closes,
+// see LogCoalescer.
+class LogShipper
+{
+public:
+    using Level = ClefWriter::Level;
+
+    // What happens to an event when the queue is full.
+    enum class Overflow
+    {
+        // The new event is dropped.
+        DropNewest,
+        // The oldest queued event is dropped to make room.
+        DropOldest,
+        // The oldest queued Debug event is dropped to make room, a new Debug
+        // event or one arriving when none is queued is dropped itself.
+        DropDebugFirst,
+        // Enqueue() waits up to |block_timeout| for room, then drops it.
+        Block,
+        // Like DropNewest, but while the server is slow and the queue at
+        // least half full, batches go to the spool instead of waiting in
+        // memory. Needs a spool, without one it's DropNewest.
+        Spill
+    };
+
+    struct Options
+    {
+        std::size_t batch_size = 50;
+        std::chrono::milliseconds linger{ 1000 };
+        std::size_t queue_capacity = 1000;
+        Overflow overflow = Overflow::DropNewest;
+        std::chrono::milliseconds block_timeout{ 1000 };
+        // Events per second allowed for each level, 0 is unlimited. Bursts
+        // of up to one second's worth pass.
+        double rate_limit[static_cast<std::size_t>(Level::Count)] = {};
+        // 0 ships every repeat.
+        std::chrono::milliseconds coalesce_window{ 0 };
+        // Distinct events tracked for repeats at once.
+        std::size_t coalesce_capacity = 128;
+        std::chrono::milliseconds retry_interval{ 30000 };
+        std::size_t max_in_flight = 4;
+        bool gzip = false;
+        int gzip_level = -1;
+    };
+
+    struct Stats
+    {
+        uint64_t batches = 0;
+        uint64_t events = 0;
+        // Lost to the overflow policy or a full ring, and to the rate limit.
+        uint64_t dropped = 0;
+        uint64_t rate_limited = 0;
+        // Enqueue() calls that had to wait for room, and events sent to the
+        // spool because the queue backed up.
+        uint64_t blocked = 0;
+        uint64_t spilled = 0;
+        // Repeats folded into RepeatCount events.
+        uint64_t coalesced = 0;
+        // Body size before and after compression.
+        uint64_t raw_bytes = 0;
+        uint64_t sent_bytes = 0;
+        std::chrono::microseconds compress_time{ 0 };
+    };
+
+    // Posts complete request bodies, several at a time. Only used from the
+    // shipper thread.
+    class Transport
+    {
+    public:
+        struct Result
+        {
+            uint64_t id;
+            bool ok;
+        };
+
+        virtual ~Transport() = default;
+
+        // Most requests in flight at once.
+        virtual std::size_t Capacity() const = 0;
+        // Starts posting |body|, its Result carries |id|. Returns false if
+        // the request couldn't be started, which counts as failed.
+        virtual bool Start(const std::string& body, uint64_t id) = 0;
+        // Waits at most |timeout| for requests to finish and appends their
+        // results to |done|.
+        virtual void Poll(std::chrono::milliseconds timeout, std::vector<Result>& done) = 0;
+    };
+
+    // Events are serialized by a copy of |writer|.
+    LogShipper(const Options& options, const ClefWriter& writer, std::unique_ptr<Transport> transport,
+               std::unique_ptr<LogSpool> spool = nullptr);
+    ~LogShipper();
+
+    LogShipper(const LogShipper&) = delete;
+    LogShipper& operator=(const LogShipper&) = delete;
+
+    void Start();
+    // Sends everything still queued, waits for the requests in flight,
+    // joins the worker thread and releases the transport. Can be called
+    // from several threads, later calls return once the first is done.
+    void Stop();
+
+    // Sends what is queued without waiting for the batch to fill up and
+    // retries spooled events right away. Doesn't wait for the result.
+    void Flush();
+
+    // Queues |record| stamped with the current time, from any thread.
+    // Takes a few atomic operations and a copy of the record unless the
+    // ring is full, returns false if the event was dropped by the rate limit
+    // or because the ring was full.
+    bool Enqueue(Level level, const char* record, std::size_t size);
+    bool Enqueue(Level level, const LogRecord& record) { return Enqueue(level, record.Data(), record.Size()); }
+
+    Stats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Queued
+    {
+        std::string event;
+        Level level;
+    };
+
+    // A request in flight.
+    struct Batch
+    {
+        uint64_t id;
+        std::vector<std::string> events;
+        bool done;
+        bool ok;
+    };
+
+    void Run();
+    bool Stopping() const;
+    // Like cv_.wait_until() but keeps the requests in flight moving, and
+    // returns early once one of them finishes.
+    // Enqueue() wakes the worker once |wake_at| events are in the ring.
+    template <typename Ready>
+    void Wait(std::unique_lock<std::mutex>& lock, Clock::time_point deadline, std::size_t wake_at, Ready ready);
+    bool HasRoom() const;
+    // Whether the next batch goes to the spool instead of waiting for room.
+    bool SpillDue() const;
+    // Blocks a caller of Enqueue() until the ring has room, false if there
+    // is none by |deadline|.
+    bool WaitForRoom(Clock::time_point deadline);
+    // Moves events from the ring to the queue, with mutex_ held, along with
+    // the repeats of closed coalescing windows.
+    void Take();
+    void Admit(const EventRing::Event& event, Clock::time_point now);
+    void AdmitRepeats(const LogCoalescer::Repeats& repeats);
+    // Queues a new event, nullptr if the overflow policy drops it instead.
+    std::string* Push(Level level);
+    // Makes room for one more event according to the overflow policy,
+    // false if the new one has to be dropped instead.
+    bool MakeRoom(Level level);
+    void PopFront();
+    bool ReplayDue() const;
+    void Deliver(std::vector<std::string>&& events);
+    // Starts requests for spooled events while there is room.
+    void Replay();
+    void Post(std::vector<std::string>&& events, bool spooled);
+    // Waits at most |timeout| for requests to finish and settles them.
+    // Returns true if any did.
+    bool Poll(std::chrono::milliseconds timeout);
+    void Settle();
+
+    const Options options_;
+    const ClefWriter writer_;
+    EventRing ring_;
+    TokenBucket rate_limits_[static_cast<std::size_t>(Level::Count)];
+    // How many events in the ring wake the worker, 0 while it's awake or
+    // already being woken.
+    std::atomic<std::size_t> wake_at_{ 0 };
+    std::atomic<uint64_t> ring_full_{ 0 };
+    std::atomic<uint64_t> rate_limited_{ 0 };
+    std::atomic<uint64_t> blocked_{ 0 };
+
+    // Only touched by the worker thread.
+    std::deque<Queued> queue_;
+    std::size_t queued_debug_ = 0;
+    LogCoalescer coalescer_;
+    // Sent event buffers kept for reuse so steady state serializing doesn't
+    // allocate.
+    std::vector<std::string> free_;
+    std::unique_ptr<Transport> transport_;
+    std::unique_ptr<LogSpool> spool_;
+    Clock::time_point retry_at_;
+    std::unique_ptr<GzipWriter> gzip_;
+    std::string body_;
+    uint64_t next_id_ = 0;
+    // Requests for queued events, and for spooled ones in the order they
+    // were read, which is the order they are committed in.
+    std::deque<Batch> sending_;
+    std::deque<Batch> replaying_;
+    // A replayed batch failed, what was read after it is read again once
+    // nothing is in flight any more.
+    bool replay_failed_ = false;
+    std::vector<Transport::Result> results_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    // Signalled when the worker takes events from the ring while callers
+    // are blocked on it.
+    std::condition_variable room_cv_;
+    std::size_t blocked_callers_ = 0;
+    bool stop_ = false;
+    bool flush_ = false;
+    Stats stats_;
+    // Held by Stop() throughout.
+    std::mutex stop_mutex_;
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include "posix_compat.h"
+#endif
+#include <cstddef>
+#include <string>
+
+// Destination of the service's own log lines, written to by AsyncLogWriter
+// from its background thread only.
+class LogSink
+{
+public:
+    struct Line
+    {
+        // One of the EVENTLOG_*_TYPE values.
+        WORD type;
+        std::string text;
+    };
+
+    virtual ~LogSink() = default;
+
+    // (Re)opens the log for |source|, the name lines are reported under.
+    virtual bool Open(const std::string& source) = 0;
+
+    // Writes |count| lines in order.
+    virtual void Write(const Line* lines, std::size_t count) = 0;
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "log_spool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+    const char kSegmentExtension[] = ".spool";
+    // Record header: little endian payload length followed by its checksum.
+    const std::size_t kHeaderSize = 8;
+
+    uint32_t checksum(const char* data, std::size_t size)
+    {
+        // FNV-1a, enough to catch torn writes at the end of a segment
+        uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    void put_u32(unsigned char* out, uint32_t value)
+    {
+        out[0] = static_cast<unsigned char>(value);
+        out[1] = static_cast<unsigned char>(value >> 8);
+        out[2] = static_cast<unsigned char>(value >> 16);
+        out[3] = static_cast<unsigned char>(value >> 24);
+    }
+
+    uint32_t get_u32(const unsigned char* in)
+    {
+        return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+    }
+
+    bool sync_file(std::FILE* file)
+    {
+        if (std::fflush(file) != 0)
+            return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+LogSpool::LogSpool(const Options& options)
+    : options_(options)
+{
+}
+
+LogSpool::~LogSpool()
+{
+    CloseReader();
+    CloseWriter();
+}
+
+bool LogSpool::Open()
+{
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    if (ec)
+        return false;
+
+    segments_.clear();
+    total_bytes_ = 0;
+    for (const auto& entry : fs::directory_iterator(options_.directory, ec))
+    {
+        const fs::path& p = entry.path();
+        if (p.extension() != kSegmentExtension)
+            continue;
+
+        const std::string stem = p.stem().string();
+        char* end = nullptr;
+        const uint64_t id = std::strtoull(stem.c_str(), &end, 10);
+        if (id == 0 || *end != '\0')
+            continue;
+
+        const uint64_t size = fs::file_size(p, ec);
+        if (ec)
+            continue;
+        segments_.push_back({ id, size });
+        total_bytes_ += size;
+    }
+
+    std::sort(segments_.begin(), segments_.end(),
+              [](const Segment& a, const Segment& b) { return a.id < b.id; });
+    next_id_ = segments_.empty() ? 1 : segments_.back().id + 1;
+    return true;
+}
+
+std::string LogSpool::SegmentPath(uint64_t id) const
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "%016llu%s", static_cast<unsigned long long>(id), kSegmentExtension);
+    return (fs::path(options_.directory) / name).string();
+}
+
+bool LogSpool::OpenWriter()
+{
+    if (out_ && segments_.back().size < options_.segment_bytes)
+        return true;
+
+    CloseWriter();
+    // never append to a segment left over from a previous run, its tail
+    // might be torn
+    const uint64_t id = next_id_++;
+    out_ = std::fopen(SegmentPath(id).c_str(), "wb");
+    if (!out_)
+        return false;
+    segments_.push_back({ id, 0 });
+    return true;
+}
+
+void LogSpool::CloseWriter()
+{
+    if (out_)
+    {
+        std::fclose(out_);
+        out_ = nullptr;
+    }
+}
+
+void LogSpool::CloseReader()
+{
+    if (in_)
+    {
+        std::fclose(in_);
+        in_ = nullptr;
+    }
+    committed_offset_ = 0;
+    read_offset_ = 0;
+    // the reads were of the segment that is going away
+    stale_commits_ += unacked_.size();
+    unacked_.clear();
+}
+
+void LogSpool::RemoveOldest()
+{
+    CloseReader();
+    if (segments_.size() == 1)
+        CloseWriter();
+
+    std::error_code ec;
+    fs::remove(SegmentPath(segments_.front().id), ec);
+    total_bytes_ -= segments_.front().size;
+    segments_.pop_front();
+}
+
+void LogSpool::EnforceLimit(uint64_t incoming)
+{
+    while (!segments_.empty() && total_bytes_ + incoming > options_.max_bytes)
+    {
+        RemoveOldest();
+        ++dropped_segments_;
+    }
+}
+
+bool LogSpool::Append(const std::vector<std::string>& events)
+{
+    uint64_t incoming = 0;
+    for (const auto& e : events)
+        incoming += kHeaderSize + e.size();
+
+    EnforceLimit(incoming);
+    if (!OpenWriter())
+        return false;
+
+    bool ok = true;
+    for (const auto& e : events)
+    {
+        unsigned char header[kHeaderSize];
+        put_u32(header, static_cast<uint32_t>(e.size()));
+        put_u32(header + 4, checksum(e.data(), e.size()));
+        if (std::fwrite(header, 1, kHeaderSize, out_) != kHeaderSize ||
+            std::fwrite(e.data(), 1, e.size(), out_) != e.size())
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    // group commit, one sync for the whole batch
+    ok = sync_file(out_) && ok;
+
+    Segment& segment = segments_.back();
+    const long position = std::ftell(out_);
+    if (position >= 0)
+    {
+        total_bytes_ += static_cast<uint64_t>(position) - segment.size;
+        segment.size = static_cast<uint64_t>(position);
+    }
+
+    if (!ok)
+        CloseWriter();
+    return ok;
+}
+
+std::size_t LogSpool::Peek(std::size_t max, std::vector<std::string>& events)
+{
+    events.clear();
+    while (!segments_.empty())
+    {
+        const Segment segment = segments_.front();
+        if (!in_)
+        {
+            // seal the segment before reading it, new events go to the next one
+            if (segments_.size() == 1)
+                CloseWriter();
+
+            in_ = std::fopen(SegmentPath(segment.id).c_str(), "rb");
+            if (!in_)
+            {
+                RemoveOldest();
+                continue;
+            }
+        }
+
+        std::fseek(in_, static_cast<long>(read_offset_), SEEK_SET);
+        while (events.size() < max)
+        {
+            unsigned char header[kHeaderSize];
+            if (std::fread(header, 1, kHeaderSize, in_) != kHeaderSize)
+                break;
+
+            // a torn header can claim any size, check it before allocating
+            const uint32_t size = get_u32(header);
+            bool torn = read_offset_ + kHeaderSize + size > segment.size;
+            std::string event;
+            if (!torn)
+            {
+                event.resize(size);
+                torn = std::fread(&event[0], 1, size, in_) != size
+                    || checksum(event.data(), size) != get_u32(header + 4);
+            }
+            if (torn)
+            {
+                // nothing after it can be trusted
+                read_offset_ = segment.size;
+                break;
+            }
+
+            events.push_back(std::move(event));
+            read_offset_ += kHeaderSize + size;
+        }
+
+        if (!events.empty())
+        {
+            unacked_.push_back(read_offset_);
+            return events.size();
+        }
+        // the segment goes once the reads in flight are committed
+        if (!unacked_.empty())
+            return 0;
+
+        RemoveOldest();
+    }
+    return 0;
+}
+
+void LogSpool::Commit()
+{
+    if (stale_commits_ != 0)
+    {
+        --stale_commits_;
+        return;
+    }
+    if (unacked_.empty())
+        return;
+    committed_offset_ = unacked_.front();
+    unacked_.pop_front();
+    if (!segments_.empty() && unacked_.empty() && committed_offset_ >= segments_.front().size)
+        RemoveOldest();
+}
+
+void LogSpool::Rewind()
+{
+    unacked_.clear();
+    stale_commits_ = 0;
+    read_offset_ = committed_offset_;
+}
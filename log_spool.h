@@ -0,0 +1,87 @@
+#ifndef LOG_SPOOL_H
+#define LOG_SPOOL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+// On-disk spool for log events that could not be delivered.
+// Events are appended to numbered segment files as length-prefixed,
+// checksummed records, one fsync per appended batch. Segments are read back
+// oldest first and deleted once everything in them has been delivered.
+// Survives restarts: existing segments are picked up by Open().
+// Not thread safe, the shipper thread is the only user.
+class LogSpool
+{
+public:
+    struct Options
+    {
+        std::string directory;
+        uint64_t segment_bytes = 1 << 20;
+        // Oldest segments are dropped when the spool would grow past this.
+        uint64_t max_bytes = 64 << 20;
+    };
+
+    explicit LogSpool(const Options& options);
+    ~LogSpool();
+
+    LogSpool(const LogSpool&) = delete;
+    LogSpool& operator=(const LogSpool&) = delete;
+
+    // Creates the directory if needed and scans existing segments.
+    bool Open();
+
+    // Appends |events| and syncs them to disk.
+    bool Append(const std::vector<std::string>& events);
+
+    bool Empty() const { return segments_.empty(); }
+
+    // Reads up to |max| undelivered events into |events| without consuming
+    // them, oldest first and following on from the previous Peek() so
+    // several reads can be in flight. Returns the number of events read, 0
+    // if there are none or the rest of the oldest segment waits for its
+    // commits.
+    std::size_t Peek(std::size_t max, std::vector<std::string>& events);
+
+    // Marks the events of the oldest uncommitted Peek() as delivered.
+    void Commit();
+    // Forgets the uncommitted Peek()s, the next one reads their events
+    // again.
+    void Rewind();
+
+    uint64_t DroppedSegments() const { return dropped_segments_; }
+
+private:
+    struct Segment
+    {
+        uint64_t id;
+        uint64_t size;
+    };
+
+    std::string SegmentPath(uint64_t id) const;
+    bool OpenWriter();
+    void CloseWriter();
+    void CloseReader();
+    void RemoveOldest();
+    void EnforceLimit(uint64_t incoming);
+
+    const Options options_;
+    std::deque<Segment> segments_;
+    uint64_t total_bytes_ = 0;
+    uint64_t next_id_ = 1;
+    uint64_t dropped_segments_ = 0;
+
+    std::FILE* out_ = nullptr;
+
+    std::FILE* in_ = nullptr;
+    uint64_t committed_offset_ = 0;
+    uint64_t read_offset_ = 0;
+    // End offsets of the uncommitted Peek()s in the oldest segment.
+    std::deque<uint64_t> unacked_;
+    // Commits still to come for reads of a segment dropped since.
+    std::size_t stale_commits_ = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef POSIX_COMPAT_H
+#define POSIX_COMPAT_H
+
+// The subset of Win32 names the services use, so the same service code
+// builds on POSIX hosts with service_base_posix.cpp.
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+
+using DWORD = uint32_t;
+using WORD = uint16_t;
+using TCHAR = char;
+
+#define _T(x) x
+#define WINAPI
+
+const DWORD NO_ERROR = 0;
+const DWORD ERROR_SERVICE_SPECIFIC_ERROR = 1066;
+
+// Service states, see SetServiceStatus().
+const DWORD SERVICE_STOPPED = 0x1;
+const DWORD SERVICE_START_PENDING = 0x2;
+const DWORD SERVICE_STOP_PENDING = 0x3;
+const DWORD SERVICE_RUNNING = 0x4;
+const DWORD SERVICE_CONTINUE_PENDING = 0x5;
+const DWORD SERVICE_PAUSE_PENDING = 0x6;
+const DWORD SERVICE_PAUSED = 0x7;
+
+const DWORD SERVICE_ACCEPT_STOP = 0x1;
+const DWORD SERVICE_ACCEPT_PAUSE_CONTINUE = 0x2;
+const DWORD SERVICE_ACCEPT_SHUTDOWN = 0x4;
+const DWORD SERVICE_ACCEPT_PARAMCHANGE = 0x8;
+const DWORD SERVICE_ACCEPT_SESSIONCHANGE = 0x80;
+
+const DWORD SERVICE_AUTO_START = 0x2;
+const DWORD SERVICE_DEMAND_START = 0x3;
+const DWORD SERVICE_ERROR_NORMAL = 0x1;
+
+const WORD EVENTLOG_ERROR_TYPE = 0x1;
+const WORD EVENTLOG_WARNING_TYPE = 0x2;
+const WORD EVENTLOG_INFORMATION_TYPE = 0x4;
+
+struct WTSSESSION_NOTIFICATION
+{
+    DWORD cbSize;
+    DWORD dwSessionId;
+};
+
+inline DWORD GetLastError()
+{
+    return static_cast<DWORD>(errno);
+}
+
+class CString : public std::string
+{
+public:
+    CString() = default;
+    CString(const char* s) : std::string(s) {}
+    CString(const std::string& s) : std::string(s) {}
+
+    operator const TCHAR*() const { return c_str(); }
+};
+
+#endif // POSIX_COMPAT_H
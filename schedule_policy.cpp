@@ -0,0 +1,59 @@
+#include "schedule_policy.h"
+
+#include <algorithm>
+
+SchedulePolicy::SchedulePolicy(const Options& options, uint32_t seed)
+    : options_(options)
+    , random_(seed)
+{
+}
+
+SchedulePolicy::Clock::duration SchedulePolicy::Random(std::chrono::seconds max)
+{
+    const auto limit = std::chrono::duration_cast<std::chrono::milliseconds>(max).count();
+    if (limit <= 0)
+        return Clock::duration::zero();
+    std::uniform_int_distribution<long long> dist(0, limit);
+    return std::chrono::milliseconds{ dist(random_) };
+}
+
+SchedulePolicy::Clock::time_point SchedulePolicy::First(Clock::time_point now)
+{
+    failures_ = 0;
+    base_ = now + options_.interval + Random(options_.splay);
+    return base_ + Random(options_.jitter);
+}
+
+SchedulePolicy::Clock::time_point SchedulePolicy::Next(Clock::time_point now, Result result)
+{
+    switch (result)
+    {
+    case Result::Failed:
+    {
+        ++failures_;
+        Clock::duration delay = options_.interval;
+        if (options_.max_backoff > options_.interval)
+        {
+            // interval * 2^failures, capped without overflowing
+            const Clock::duration cap = options_.max_backoff;
+            for (unsigned i = 0; i < failures_ && delay < cap; ++i)
+                delay *= 2;
+            delay = std::min(delay, cap);
+        }
+        base_ = now + delay;
+        break;
+    }
+    case Result::Updated:
+        failures_ = 0;
+        base_ = now + (options_.after_update.count() != 0 ? options_.after_update : options_.interval);
+        break;
+    case Result::NoUpdates:
+        failures_ = 0;
+        // keep to the cadence, skipping runs missed while this one overran
+        base_ += options_.interval;
+        if (base_ <= now)
+            base_ = now + options_.interval;
+        break;
+    }
+    return base_ + Random(options_.jitter);
+}
@@ -0,0 +1,68 @@
+#ifndef SCHEDULE_POLICY_H
+#define SCHEDULE_POLICY_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Decides when a job runs next.
+// The current time is always passed in rather than read from a clock, and
+// the random source is seeded explicitly, so a policy can be driven with a
+// fake clock and a fixed seed.
+//
+// - splay:        the first run is delayed by a random part of it, and the
+//                 whole cadence keeps that offset, so hosts started at the
+//                 same moment stay apart.
+// - jitter:       every run is delayed by a random part of it, without
+//                 shifting the cadence.
+// - max_backoff:  after a failed run the delay doubles per consecutive
+//                 failure, starting from |interval|, up to this. Zero
+//                 disables backoff.
+// - after_update: delay after a run that found and installed an update.
+//                 Zero means |interval|.
+class SchedulePolicy
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::chrono::seconds interval{ 300 };
+        std::chrono::seconds splay{ 0 };
+        std::chrono::seconds jitter{ 0 };
+        std::chrono::seconds max_backoff{ 0 };
+        std::chrono::seconds after_update{ 0 };
+    };
+
+    enum class Result
+    {
+        NoUpdates,
+        Updated,
+        Failed
+    };
+
+    SchedulePolicy(const Options& options, uint32_t seed);
+
+    // Time of the first run for a job scheduled at |now|.
+    Clock::time_point First(Clock::time_point now);
+
+    // Time of the next run after a run that ended at |now| with |result|.
+    Clock::time_point Next(Clock::time_point now, Result result);
+
+    unsigned Failures() const { return failures_; }
+
+    // Takes effect from the next call to Next(), the current cadence and
+    // failure count are kept.
+    void SetOptions(const Options& options) { options_ = options; }
+
+private:
+    Clock::duration Random(std::chrono::seconds max);
+
+    Options options_;
+    std::mt19937 random_;
+    // Run time before jitter, the fixed cadence is kept relative to it.
+    Clock::time_point base_;
+    unsigned failures_ = 0;
+};
+
+#endif
@@ -0,0 +1,205 @@
+// Drives SchedulePolicy with a fake clock and fixed seeds.
+//
+//   schedule_policy_test
+
+#include "schedule_policy.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    using Clock = SchedulePolicy::Clock;
+    using std::chrono::seconds;
+
+    int g_failures = 0;
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+    // Any fixed point will do, the policy never reads the clock.
+    const Clock::time_point kStart = Clock::time_point{} + std::chrono::hours{ 1000 };
+
+    SchedulePolicy::Options options(seconds interval)
+    {
+        SchedulePolicy::Options options;
+        options.interval = interval;
+        return options;
+    }
+
+    void test_plain_interval()
+    {
+        SchedulePolicy policy(options(seconds{ 300 }), 1);
+        const Clock::time_point first = policy.First(kStart);
+        CHECK(first == kStart + seconds{ 300 });
+        CHECK(policy.Next(first + seconds{ 10 }, SchedulePolicy::Result::NoUpdates) == first + seconds{ 300 });
+        CHECK(policy.Failures() == 0);
+    }
+
+    void test_splay()
+    {
+        SchedulePolicy::Options splayed = options(seconds{ 300 });
+        splayed.splay = seconds{ 600 };
+
+        bool spread = false;
+        Clock::time_point previous;
+        for (uint32_t seed = 0; seed < 50; ++seed)
+        {
+            SchedulePolicy policy(splayed, seed);
+            const Clock::time_point first = policy.First(kStart);
+            CHECK(first >= kStart + seconds{ 300 } && first <= kStart + seconds{ 900 });
+            // the offset stays with the cadence
+            CHECK(policy.Next(first + seconds{ 1 }, SchedulePolicy::Result::NoUpdates) == first + seconds{ 300 });
+            if (seed != 0 && first != previous)
+                spread = true;
+            previous = first;
+
+            // a seed always gives the same offset
+            SchedulePolicy again(splayed, seed);
+            CHECK(again.First(kStart) == first);
+        }
+        CHECK(spread);
+    }
+
+    void test_jitter()
+    {
+        SchedulePolicy::Options jittered = options(seconds{ 300 });
+        jittered.jitter = seconds{ 30 };
+        SchedulePolicy policy(jittered, 7);
+
+        Clock::time_point base = kStart + seconds{ 300 };
+        Clock::time_point next = policy.First(kStart);
+        Clock::duration low = seconds{ 30 };
+        Clock::duration high = Clock::duration::zero();
+        for (int i = 0; i < 1000; ++i)
+        {
+            const Clock::duration delay = next - base;
+            CHECK(delay >= Clock::duration::zero() && delay <= seconds{ 30 });
+            low = std::min(low, delay);
+            high = std::max(high, delay);
+            // runs start late by the jitter but the cadence doesn't drift
+            next = policy.Next(next + seconds{ 5 }, SchedulePolicy::Result::NoUpdates);
+            base += seconds{ 300 };
+        }
+        CHECK(low < seconds{ 3 } && high > seconds{ 27 });
+    }
+
+    void test_backoff()
+    {
+        SchedulePolicy::Options backoff = options(seconds{ 300 });
+        backoff.max_backoff = seconds{ 3600 };
+        SchedulePolicy policy(backoff, 1);
+        policy.First(kStart);
+
+        const seconds expected[] = { seconds{ 600 }, seconds{ 1200 }, seconds{ 2400 }, seconds{ 3600 }, seconds{ 3600 } };
+        Clock::time_point now = kStart;
+        for (unsigned i = 0; i < 5; ++i)
+        {
+            const Clock::time_point next = policy.Next(now, SchedulePolicy::Result::Failed);
+            CHECK(next - now == expected[i]);
+            CHECK(policy.Failures() == i + 1);
+            now = next + seconds{ 1 };
+        }
+        // many failures in a row still stay at the cap
+        Clock::time_point due = now;
+        for (int i = 0; i < 100; ++i)
+        {
+            due = policy.Next(now, SchedulePolicy::Result::Failed);
+            CHECK(due - now == seconds{ 3600 });
+            now = due + seconds{ 1 };
+        }
+
+        // a good run resets it and the cadence goes on from the run
+        const Clock::time_point next = policy.Next(now, SchedulePolicy::Result::NoUpdates);
+        CHECK(policy.Failures() == 0);
+        CHECK(next == due + seconds{ 300 });
+        CHECK(policy.Next(next, SchedulePolicy::Result::Failed) - next == seconds{ 600 });
+    }
+
+    void test_backoff_disabled()
+    {
+        SchedulePolicy policy(options(seconds{ 300 }), 1);
+        policy.First(kStart);
+        for (int i = 0; i < 5; ++i)
+            CHECK(policy.Next(kStart, SchedulePolicy::Result::Failed) - kStart == seconds{ 300 });
+        CHECK(policy.Failures() == 5);
+    }
+
+    void test_after_update()
+    {
+        SchedulePolicy::Options updated = options(seconds{ 300 });
+        updated.after_update = seconds{ 60 };
+        updated.max_backoff = seconds{ 3600 };
+        SchedulePolicy policy(updated, 1);
+        policy.First(kStart);
+        policy.Next(kStart, SchedulePolicy::Result::Failed);
+
+        const Clock::time_point now = kStart + seconds{ 1000 };
+        const Clock::time_point next = policy.Next(now, SchedulePolicy::Result::Updated);
+        CHECK(next - now == seconds{ 60 });
+        CHECK(policy.Failures() == 0);
+        // the cadence carries on from the shortened run
+        CHECK(policy.Next(next + seconds{ 5 }, SchedulePolicy::Result::NoUpdates) == next + seconds{ 300 });
+
+        // unset means the interval
+        SchedulePolicy plain(options(seconds{ 300 }), 1);
+        plain.First(kStart);
+        CHECK(plain.Next(now, SchedulePolicy::Result::Updated) - now == seconds{ 300 });
+    }
+
+    void test_overrun()
+    {
+        SchedulePolicy policy(options(seconds{ 300 }), 1);
+        const Clock::time_point first = policy.First(kStart);
+
+        // ran for two and a half intervals, the missed runs are skipped
+        // rather than started back to back
+        const Clock::time_point late = first + seconds{ 750 };
+        const Clock::time_point next = policy.Next(late, SchedulePolicy::Result::NoUpdates);
+        CHECK(next == late + seconds{ 300 });
+
+        // ending exactly on the next run also skips it
+        CHECK(policy.Next(next + seconds{ 300 }, SchedulePolicy::Result::NoUpdates) == next + seconds{ 600 });
+    }
+
+    void test_set_options()
+    {
+        SchedulePolicy::Options backoff = options(seconds{ 300 });
+        backoff.max_backoff = seconds{ 3600 };
+        SchedulePolicy policy(backoff, 1);
+        const Clock::time_point first = policy.First(kStart);
+        policy.Next(first, SchedulePolicy::Result::Failed);
+
+        backoff.interval = seconds{ 100 };
+        policy.SetOptions(backoff);
+        // the failure count survives, the new interval applies
+        CHECK(policy.Next(first, SchedulePolicy::Result::Failed) - first == seconds{ 400 });
+        CHECK(policy.Failures() == 2);
+    }
+}
+
+int main()
+{
+    test_plain_interval();
+    test_splay();
+    test_jitter();
+    test_backoff();
+    test_backoff_disabled();
+    test_after_update();
+    test_overrun();
+    test_set_options();
+    if (g_failures != 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("schedule_policy_test: all checks passed\n");
+    return 0;
+}
@@ -1,8 +1,15 @@
 #include "service_base.h"
+#include "event_log_sink.h"
 #include <cassert>
+#include <cstdlib>
 
 ServiceBase* ServiceBase::m_service = nullptr;
 
+// How often the watchdog looks for stalled heartbeats.
+static const std::chrono::seconds kWatchdogInterval{ 1 };
+// How long stopping waits for queued log lines to be written.
+static const std::chrono::milliseconds kLogFlushTimeout{ 2000 };
+
 ServiceBase::ServiceBase(const CString& name,
                          const CString& displayName,
                          DWORD dwStartType,
@@ -18,6 +25,8 @@ ServiceBase::ServiceBase(const CString& name,
       m_depends(depends),
       m_account(account),
       m_password(password),
+      m_log(std::make_unique<AsyncLogWriter>(std::make_unique<EventLogSink>(), static_cast<const TCHAR*>(name))),
+      m_control([this](const ControlRequest& request) { return OnControl(request); }),
       m_svcStatusHandle(nullptr)
 {
     m_svcStatus.dwControlsAccepted = dwAcceptedCmds;
@@ -40,13 +49,12 @@ void ServiceBase::SetStatus(DWORD dwState, DWORD dwErrCode, DWORD dwWait)
 
 void ServiceBase::WriteToEventLog(const std::string& msg, WORD type) const
 {
-    HANDLE hSource = RegisterEventSource(nullptr, m_name);
-    if (hSource)
-    {
-        const TCHAR* msgData[2] = {m_name, msg.c_str()};
-        ReportEvent(hSource, type, 0, 0, nullptr, 2, 0, msgData, nullptr);
-        DeregisterEventSource(hSource);
-    }
+    m_log->Write(type, msg);
+}
+
+void ServiceBase::WriteToEventLog(const LogRecord& record, WORD type) const
+{
+    m_log->Write(type, record);
 }
 
 // static
@@ -88,6 +96,10 @@ DWORD WINAPI ServiceBase::ServiceCtrlHandler(DWORD ctrlCode, DWORD evtType,
         m_service->Shutdown();
         break;
 
+    case SERVICE_CONTROL_PARAMCHANGE:
+        m_service->OnParamChange();
+        break;
+
     case SERVICE_CONTROL_SESSIONCHANGE:
         m_service->OnSessionChange(evtType, reinterpret_cast<WTSSESSION_NOTIFICATION*>(evtData));
         break;
@@ -117,13 +129,33 @@ void ServiceBase::Start(DWORD argc, TCHAR* argv[])
 {
     SetStatus(SERVICE_START_PENDING);
     OnStart(argc, argv);
+    m_watchdog.Start(kWatchdogInterval, [this](const Watchdog::Stall& stall) { OnStall(stall); });
+
+    const std::string endpoint = control_endpoint(static_cast<const TCHAR*>(m_name));
+    if (m_control.Listen(endpoint))
+        m_controlThread = std::thread([this] { m_control.Run(); });
+    else
+        WriteToEventLog("Can't create control pipe " + endpoint + ": " + std::to_string(GetLastError()),
+                        EVENTLOG_WARNING_TYPE);
+
     SetStatus(SERVICE_RUNNING);
 }
 
+void ServiceBase::StopControl()
+{
+    m_control.Stop();
+    if (m_controlThread.joinable())
+        m_controlThread.join();
+    m_control.Close();
+}
+
 void ServiceBase::Stop()
 {
     SetStatus(SERVICE_STOP_PENDING);
+    StopControl();
+    m_watchdog.Stop();
     OnStop();
+    m_log->Flush(kLogFlushTimeout);
     SetStatus(SERVICE_STOPPED);
 }
 
@@ -143,6 +175,29 @@ void ServiceBase::Continue()
 
 void ServiceBase::Shutdown()
 {
+    StopControl();
+    m_watchdog.Stop();
     OnShutdown();
+    m_log->Flush(kLogFlushTimeout);
     SetStatus(SERVICE_STOPPED);
 }
+
+void ServiceBase::OnStall(const Watchdog::Stall& stall)
+{
+    const auto overdue = std::chrono::duration_cast<std::chrono::milliseconds>(stall.overdue);
+    WriteToEventLog(stall.heartbeat->Name() + " stalled in " + (stall.stage ? stall.stage : "unknown stage")
+                        + ", " + std::to_string(overdue.count()) + " ms past its deadline",
+                    EVENTLOG_ERROR_TYPE);
+}
+
+void ServiceBase::ReportFailure(DWORD dwErrCode)
+{
+    m_log->Flush(kLogFlushTimeout);
+    SetStatus(SERVICE_STOPPED, dwErrCode);
+    std::_Exit(EXIT_FAILURE);
+}
+
+ControlReply ServiceBase::OnControl(const ControlRequest& request)
+{
+    return { false, std::string(control_command_name(request.command)) + " is not supported" };
+}
@@ -1,11 +1,26 @@
 #ifndef SERVICE_BASE_H_
 #define SERVICE_BASE_H_
 
+#ifdef _WIN32
 #include <windows.h>
 #include <atlstr.h>
+#else
+#include "posix_compat.h"
+#include "systemd_notifier.h"
+#endif
+#include <memory>
 #include <string>
+#ifdef _WIN32
+#include <thread>
+#endif
+
+#include "async_log_writer.h"
+#include "control_server.h"
+#include "watchdog.h"
 
 // Base Service class used to create windows services.
+// On POSIX hosts the same lifecycle is driven by signals and reported to
+// systemd, see service_base_posix.cpp.
 class ServiceBase
 {
 public:
@@ -44,13 +59,19 @@ protected:
                 const CString& account = _T(""),
                 const CString& password = _T(""));
 
-    void SetName(CString name) { m_name = name; }
+    void SetName(CString name)
+    {
+        m_name = name;
+        m_log->SetSource(static_cast<const TCHAR*>(m_name));
+    }
 
     void SetStatus(DWORD dwState, DWORD dwErrCode = NO_ERROR, DWORD dwWait = 0);
 
-    // TODO(Olster): Move out of class/make static.
-    // Writes |msg| to Windows event log.
+    // Queues |msg| for the Windows event log (the journal on Linux), the
+    // write happens on a background thread.
     void WriteToEventLog(const std::string& msg, WORD type = EVENTLOG_INFORMATION_TYPE) const;
+    // Same for a message rendered from |record| on the background thread.
+    void WriteToEventLog(const LogRecord& record, WORD type = EVENTLOG_INFORMATION_TYPE) const;
 
     // Overro=ide these functions as you need.
     virtual void OnStart(DWORD argc, TCHAR* argv[]) = 0;
@@ -71,18 +92,48 @@ protected:
     {
     }
 
+    // The configuration changed, SERVICE_CONTROL_PARAMCHANGE or SIGHUP.
+    virtual void OnParamChange()
+    {
+    }
+
     virtual void OnSessionChange(DWORD /*evtType*/,
                                  WTSSESSION_NOTIFICATION* /*notification*/)
     {
     }
 
+    // Worker threads register their heartbeats here during OnStart(), the
+    // watchdog runs while the service does.
+    Watchdog& GetWatchdog() { return m_watchdog; }
+
+    // Called on the watchdog thread for every stalled heartbeat, logs it by
+    // default.
+    virtual void OnStall(const Watchdog::Stall& stall);
+
+    // Tells the service manager the service failed so its recovery actions
+    // kick in, and exits without waiting for stuck threads.
+    [[noreturn]] void ReportFailure(DWORD dwErrCode);
+
+    // Answers a request from the local control channel (see service_ctl).
+    // Called on the control loop thread, the signal loop on POSIX, so it
+    // must return quickly.
+    virtual ControlReply OnControl(const ControlRequest& request);
+
+    // Log lines lost because the queue was full.
+    uint64_t DroppedLogLines() const { return m_log->Dropped(); }
+
 private:
+#ifdef _WIN32
     // Registers handle and starts the service.
     static void WINAPI SvcMain(DWORD argc, TCHAR* argv[]);
 
     // Called whenever service control manager updates service status.
     static DWORD WINAPI ServiceCtrlHandler(DWORD ctrlCode, DWORD evtType,
                                            void* evtData, void* context);
+#else
+    // Dispatches signals read from |signalFd| until the service stops.
+    bool RunSignalLoop(int signalFd);
+#endif
 
     static bool RunInternal(ServiceBase* svc);
 
@@ -91,6 +142,9 @@ private:
     void Pause();
     void Continue();
     void Shutdown();
+#ifdef _WIN32
+    void StopControl();
+#endif
 
     CString m_name;
     CString m_displayName;
@@ -105,8 +159,18 @@ private:
     bool m_hasAcc = false;
     bool m_hasPass = false;
 
+    std::unique_ptr<AsyncLogWriter> m_log;
+    Watchdog m_watchdog;
+    ControlServer m_control;
+
+#ifdef _WIN32
     SERVICE_STATUS m_svcStatus;
     SERVICE_STATUS_HANDLE m_svcStatusHandle;
+    std::thread m_controlThread;
+#else
+    DWORD m_controlsAccepted;
+    SystemdNotifier m_notifier;
+#endif
 
     static ServiceBase* m_service;
 };
@@ -0,0 +1,276 @@
+#include "service_base.h"
+#include "journal_sink.h"
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <vector>
+
+// Signals mapped onto service controls:
+//   SIGTERM, SIGINT - stop
+//   SIGPWR          - shutdown
+//   SIGUSR1         - pause
+//   SIGUSR2         - continue
+//   SIGHUP          - parameters changed
+
+ServiceBase* ServiceBase::m_service = nullptr;
+
+// How often the watchdog looks for stalled heartbeats.
+static const std::chrono::seconds kWatchdogInterval{ 1 };
+// How long stopping waits for queued log lines to be written.
+static const std::chrono::milliseconds kLogFlushTimeout{ 2000 };
+
+ServiceBase::ServiceBase(const CString& name,
+                         const CString& displayName,
+                         DWORD dwStartType,
+                         DWORD dwErrCtrlType,
+                         DWORD dwAcceptedCmds,
+                         const CString& depends,
+                         const CString& account,
+                         const CString& password)
+    : m_name(name),
+      m_displayName(displayName),
+      m_dwStartType(dwStartType),
+      m_dwErrorCtrlType(dwErrCtrlType),
+      m_depends(depends),
+      m_account(account),
+      m_password(password),
+      m_log(std::make_unique<AsyncLogWriter>(std::make_unique<JournalSink>(), name)),
+      m_control([this](const ControlRequest& request) { return OnControl(request); }),
+      m_controlsAccepted(dwAcceptedCmds)
+{
+}
+
+void ServiceBase::SetStatus(DWORD dwState, DWORD dwErrCode, DWORD dwWait)
+{
+    std::string state;
+    switch (dwState)
+    {
+    case SERVICE_RUNNING:
+        state = "READY=1\nSTATUS=Running";
+        break;
+    case SERVICE_PAUSED:
+        state = "STATUS=Paused";
+        break;
+    case SERVICE_STOP_PENDING:
+        state = "STOPPING=1";
+        break;
+    case SERVICE_STOPPED:
+        // systemd reads ERRNO= as an errno, a Win32 code only goes into the
+        // status text; a failed stop always ends in EXIT_FAILURE
+        if (dwErrCode != NO_ERROR)
+            state = "STATUS=Stopped, error " + std::to_string(dwErrCode) + "\nEXIT_STATUS="
+                    + std::to_string(EXIT_FAILURE);
+        break;
+    default:
+        break;
+    }
+
+    // same meaning as the SCM wait hint, in milliseconds
+    if (dwWait != 0)
+    {
+        if (!state.empty())
+            state += '\n';
+        state += "EXTEND_TIMEOUT_USEC=" + std::to_string(uint64_t{ dwWait } * 1000);
+    }
+
+    m_notifier.Notify(state);
+}
+
+void ServiceBase::WriteToEventLog(const std::string& msg, WORD type) const
+{
+    m_log->Write(type, msg);
+}
+
+void ServiceBase::WriteToEventLog(const LogRecord& record, WORD type) const
+{
+    m_log->Write(type, record);
+}
+
+bool ServiceBase::RunInternal(ServiceBase* svc)
+{
+    m_service = svc;
+
+    // block the control signals before any thread is started so every
+    // thread inherits the mask and they are only delivered to the signalfd
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGPWR);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
+    sigaddset(&mask, SIGHUP);
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0)
+    {
+        m_service->WriteToEventLog("Can't block control signals", EVENTLOG_ERROR_TYPE);
+        return false;
+    }
+
+    const int signalFd = signalfd(-1, &mask, SFD_CLOEXEC);
+    if (signalFd == -1)
+    {
+        m_service->WriteToEventLog("Can't create signalfd", EVENTLOG_ERROR_TYPE);
+        return false;
+    }
+
+    m_service->m_notifier.Open();
+
+    TCHAR* argv[] = { const_cast<TCHAR*>(m_service->GetName().c_str()), nullptr };
+    m_service->Start(1, argv);
+
+    const std::string endpoint = control_endpoint(m_service->GetName());
+    if (!m_service->m_control.Listen(endpoint))
+        m_service->WriteToEventLog("Can't listen on " + endpoint + ": " + std::to_string(errno),
+                                   EVENTLOG_WARNING_TYPE);
+
+    const bool result = m_service->RunSignalLoop(signalFd);
+    m_service->m_control.Close();
+    close(signalFd);
+    return result;
+}
+
+bool ServiceBase::RunSignalLoop(int signalFd)
+{
+    using namespace std::chrono;
+
+    // the control channel is served from this loop too, the signalfd is
+    // always the first entry
+    std::vector<pollfd> fds;
+
+    // systemd recommends pinging at half the watchdog interval
+    const milliseconds watchdog = duration_cast<milliseconds>(m_notifier.WatchdogInterval() / 2);
+    auto nextPing = steady_clock::now() + watchdog;
+
+    while (true)
+    {
+        int timeout = -1;
+        if (watchdog.count() != 0)
+        {
+            const auto left = duration_cast<milliseconds>(nextPing - steady_clock::now());
+            timeout = left.count() > 0 ? static_cast<int>(left.count()) : 0;
+        }
+
+        fds.assign(1, { signalFd, POLLIN, 0 });
+        m_control.AppendPollFds(fds);
+        const int ready = poll(fds.data(), fds.size(), timeout);
+        if (ready == -1 && errno != EINTR)
+        {
+            WriteToEventLog("Signal loop failed: " + std::to_string(errno), EVENTLOG_ERROR_TYPE);
+            Stop();
+            return false;
+        }
+
+        if (watchdog.count() != 0 && steady_clock::now() >= nextPing)
+        {
+            m_notifier.Notify("WATCHDOG=1");
+            nextPing = steady_clock::now() + watchdog;
+        }
+
+        if (ready <= 0)
+            continue;
+
+        m_control.Process(fds.data() + 1, fds.size() - 1);
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        signalfd_siginfo info;
+        if (read(signalFd, &info, sizeof info) != sizeof info)
+            continue;
+
+        switch (info.ssi_signo)
+        {
+        case SIGTERM:
+        case SIGINT:
+            Stop();
+            return true;
+
+        case SIGPWR:
+            Shutdown();
+            return true;
+
+        case SIGUSR1:
+            if (m_controlsAccepted & SERVICE_ACCEPT_PAUSE_CONTINUE)
+                Pause();
+            break;
+
+        case SIGUSR2:
+            if (m_controlsAccepted & SERVICE_ACCEPT_PAUSE_CONTINUE)
+                Continue();
+            break;
+
+        case SIGHUP:
+            if (m_controlsAccepted & SERVICE_ACCEPT_PARAMCHANGE)
+                OnParamChange();
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+void ServiceBase::Start(DWORD argc, TCHAR* argv[])
+{
+    SetStatus(SERVICE_START_PENDING);
+    OnStart(argc, argv);
+    m_watchdog.Start(kWatchdogInterval, [this](const Watchdog::Stall& stall) { OnStall(stall); });
+    SetStatus(SERVICE_RUNNING);
+}
+
+void ServiceBase::Stop()
+{
+    SetStatus(SERVICE_STOP_PENDING);
+    m_watchdog.Stop();
+    OnStop();
+    m_log->Flush(kLogFlushTimeout);
+    SetStatus(SERVICE_STOPPED);
+}
+
+void ServiceBase::Pause()
+{
+    SetStatus(SERVICE_PAUSE_PENDING);
+    OnPause();
+    SetStatus(SERVICE_PAUSED);
+}
+
+void ServiceBase::Continue()
+{
+    SetStatus(SERVICE_CONTINUE_PENDING);
+    OnContinue();
+    SetStatus(SERVICE_RUNNING);
+}
+
+void ServiceBase::Shutdown()
+{
+    SetStatus(SERVICE_STOP_PENDING);
+    m_watchdog.Stop();
+    OnShutdown();
+    m_log->Flush(kLogFlushTimeout);
+    SetStatus(SERVICE_STOPPED);
+}
+
+void ServiceBase::OnStall(const Watchdog::Stall& stall)
+{
+    const auto overdue = std::chrono::duration_cast<std::chrono::milliseconds>(stall.overdue);
+    WriteToEventLog(stall.heartbeat->Name() + " stalled in " + (stall.stage ? stall.stage : "unknown stage")
+                        + ", " + std::to_string(overdue.count()) + " ms past its deadline",
+                    EVENTLOG_ERROR_TYPE);
+}
+
+ControlReply ServiceBase::OnControl(const ControlRequest& request)
+{
+    return { false, std::string(control_command_name(request.command)) + " is not supported" };
+}
+
+void ServiceBase::ReportFailure(DWORD dwErrCode)
+{
+    m_log->Flush(kLogFlushTimeout);
+    SetStatus(SERVICE_STOPPED, dwErrCode);
+    std::_Exit(EXIT_FAILURE);
+}
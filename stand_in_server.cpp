@@ -0,0 +1,106 @@
+#include "stand_in_server.h"
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    // Every event has exactly one.
+    const char kEventKey[] = "\"Timestamp\"";
+}
+
+StandInServer::StandInServer(std::chrono::milliseconds latency)
+    : latency_(latency)
+{
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof address;
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), length) != 0
+        || listen(listen_fd_, 64) != 0
+        || getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+    {
+        std::perror("stand-in server");
+        std::exit(1);
+    }
+    port_ = ntohs(address.sin_port);
+    std::thread([this] { Accept(); }).detach();
+}
+
+void StandInServer::Accept()
+{
+    while (true)
+    {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd == -1)
+            return;
+        ++connections_;
+        std::thread([this, fd] { Serve(fd); }).detach();
+    }
+}
+
+void StandInServer::Serve(int fd)
+{
+    static const char kReply[] = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+    static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+    std::string input;
+    char buffer[64 * 1024];
+    while (true)
+    {
+        std::size_t header_end;
+        while ((header_end = input.find("\r\n\r\n")) == std::string::npos)
+        {
+            const ssize_t size = read(fd, buffer, sizeof buffer);
+            if (size <= 0)
+            {
+                close(fd);
+                return;
+            }
+            input.append(buffer, static_cast<std::size_t>(size));
+        }
+        const char* length_header = std::strstr(input.c_str(), "Content-Length: ");
+        const std::size_t body_size = length_header ? std::strtoul(length_header + 16, nullptr, 10) : 0;
+        const std::size_t request_size = header_end + 4 + body_size;
+        // curl holds back bodies over 1 KiB until it's told to go on
+        const char* expect = std::strstr(input.c_str(), "Expect: 100-continue");
+        if (expect && expect < input.c_str() + header_end && input.size() < request_size
+            && write(fd, kContinue, sizeof kContinue - 1) != static_cast<ssize_t>(sizeof kContinue - 1))
+        {
+            close(fd);
+            return;
+        }
+        while (input.size() < request_size)
+        {
+            const ssize_t size = read(fd, buffer, sizeof buffer);
+            if (size <= 0)
+            {
+                close(fd);
+                return;
+            }
+            input.append(buffer, static_cast<std::size_t>(size));
+        }
+
+        uint64_t events = 0;
+        for (std::size_t at = input.find(kEventKey, header_end); at < request_size;
+             at = input.find(kEventKey, at + sizeof kEventKey - 1))
+            ++events;
+        input.erase(0, request_size);
+
+        if (latency_.count() != 0)
+            std::this_thread::sleep_for(latency_);
+        events_ += events;
+        if (write(fd, kReply, sizeof kReply - 1) != static_cast<ssize_t>(sizeof kReply - 1))
+        {
+            close(fd);
+            return;
+        }
+    }
+}
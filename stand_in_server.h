@@ -0,0 +1,37 @@
+#ifndef STAND_IN_SERVER_H
+#define STAND_IN_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// A stand-in for the log server on a local port, for the benchmarks.
+// Speaks HTTP/1.1 with keep-alive and Content-Length bodies, which is all
+// the shipper sends, counts the CLEF events it receives and answers each
+// request with 201 after |latency|, like a real server busy ingesting the
+// batch. Connections are served on detached threads, so it has to outlive
+// main(). POSIX only.
+class StandInServer
+{
+public:
+    explicit StandInServer(std::chrono::milliseconds latency = std::chrono::milliseconds{ 0 });
+
+    StandInServer(const StandInServer&) = delete;
+    StandInServer& operator=(const StandInServer&) = delete;
+
+    int Port() const { return port_; }
+    uint64_t Events() const { return events_; }
+    uint64_t Connections() const { return connections_; }
+
+private:
+    void Accept();
+    void Serve(int fd);
+
+    const std::chrono::milliseconds latency_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<uint64_t> events_{ 0 };
+    std::atomic<uint64_t> connections_{ 0 };
+};
+
+#endif
@@ -0,0 +1,267 @@
+// Measures how long the service takes to stop and how often its worker
+// wakes up while idle: the 5 second polling Work() and LaunchApp() did
+// before StopEvent, against waiting on a StopEvent and the JobScheduler
+// the service uses now. Each wait is measured both idle, with the next run
+// one interval away, and with an updater running. Wakeups are the worker
+// threads' voluntary context switches from /proc, stop latency is from
+// the stop request until the worker has returned, issued at a random point
+// of the 5 second polling cycle. Linux only.
+//
+//   stop_bench [idle_s] [trials]
+
+#include "job_scheduler.h"
+#include "stop_event.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <reproc++/reproc.hpp>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // The polling slice Work() and LaunchApp() used before.
+    const std::chrono::seconds kSlice{ 5 };
+    // The default check interval.
+    const std::chrono::seconds kInterval{ 300 };
+
+    const std::vector<std::string> kUpdater = { "sleep", "3600" };
+
+    class Model
+    {
+    public:
+        virtual ~Model() = default;
+        virtual void Start() = 0;
+        // Asks the worker to stop and waits until it has.
+        virtual void Stop() = 0;
+    };
+
+    // Work() before, sleeping in slices and checking exit_ between them.
+    class PollingIdle : public Model
+    {
+    public:
+        void Start() override
+        {
+            thread_ = std::thread([this] {
+                while (!exit_)
+                    std::this_thread::sleep_for(kSlice);
+            });
+        }
+        void Stop() override
+        {
+            exit_ = true;
+            thread_.join();
+        }
+
+    private:
+        std::atomic<bool> exit_{ false };
+        std::thread thread_;
+    };
+
+    // LaunchApp() before, waiting on the updater in slices.
+    class PollingUpdater : public Model
+    {
+    public:
+        void Start() override
+        {
+            thread_ = std::thread([this] {
+                reproc::process updater;
+                if (updater.start(kUpdater))
+                    return;
+                while (true)
+                {
+                    const std::error_code err = updater.wait(kSlice, nullptr);
+                    if (exit_)
+                    {
+                        if (updater.terminate())
+                            updater.kill();
+                        return;
+                    }
+                    if (err != reproc::errc::wait_timeout)
+                        return;
+                }
+            });
+        }
+        void Stop() override
+        {
+            exit_ = true;
+            thread_.join();
+        }
+
+    private:
+        std::atomic<bool> exit_{ false };
+        std::thread thread_;
+    };
+
+    // Work() with StopEvent, asleep until the next run.
+    class EventIdle : public Model
+    {
+    public:
+        void Start() override
+        {
+            thread_ = std::thread([this] {
+                Clock::time_point next = Clock::now() + kInterval;
+                while (!stop_.WaitUntil(next))
+                    next += kInterval;
+            });
+        }
+        void Stop() override
+        {
+            stop_.Set();
+            thread_.join();
+        }
+
+    private:
+        StopEvent stop_;
+        std::thread thread_;
+    };
+
+    // LaunchApp() now, one wait for the interval that OnStop() interrupts
+    // by terminating the updater.
+    class EventUpdater : public Model
+    {
+    public:
+        void Start() override
+        {
+            thread_ = std::thread([this] {
+                reproc::process updater;
+                if (updater.start(kUpdater))
+                    return;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    child_ = &updater;
+                }
+                if (stop_.IsSet())
+                    StopChild();
+                updater.wait(std::chrono::duration_cast<reproc::milliseconds>(kInterval), nullptr);
+                std::lock_guard<std::mutex> lock(mutex_);
+                child_ = nullptr;
+            });
+        }
+        void Stop() override
+        {
+            stop_.Set();
+            StopChild();
+            thread_.join();
+        }
+
+    private:
+        void StopChild()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (child_ && child_->terminate())
+                child_->kill();
+        }
+
+        StopEvent stop_;
+        std::mutex mutex_;
+        reproc::process* child_ = nullptr;
+        std::thread thread_;
+    };
+
+    // The service's scheduler with one job that isn't due yet.
+    class SchedulerIdle : public Model
+    {
+    public:
+        SchedulerIdle()
+            : scheduler_(1)
+        {
+            scheduler_.Add({ "job", Clock::now() + kInterval, [] { return Clock::now() + kInterval; } });
+        }
+        void Start() override { scheduler_.Start(); }
+        void Stop() override { scheduler_.Stop(); }
+
+    private:
+        JobScheduler scheduler_;
+    };
+
+    // Voluntary context switches of every thread but the main one.
+    uint64_t worker_wakeups()
+    {
+        const std::string main_thread = std::to_string(getpid());
+        uint64_t total = 0;
+        DIR* tasks = opendir("/proc/self/task");
+        if (!tasks)
+            return 0;
+        while (dirent* entry = readdir(tasks))
+        {
+            if (entry->d_name[0] == '.' || main_thread == entry->d_name)
+                continue;
+            std::ifstream status(std::string("/proc/self/task/") + entry->d_name + "/status");
+            std::string line;
+            while (std::getline(status, line))
+            {
+                static const char kKey[] = "voluntary_ctxt_switches:";
+                if (line.compare(0, sizeof kKey - 1, kKey) == 0)
+                    total += std::strtoull(line.c_str() + sizeof kKey - 1, nullptr, 10);
+            }
+        }
+        closedir(tasks);
+        return total;
+    }
+
+    void run(const char* name, std::function<std::unique_ptr<Model>()> make, std::chrono::seconds idle, int trials,
+             std::mt19937& random)
+    {
+        double wakeups_per_hour = 0;
+        {
+            const auto model = make();
+            model->Start();
+            // past starting up
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+            const uint64_t before = worker_wakeups();
+            std::this_thread::sleep_for(idle);
+            const uint64_t wakeups = worker_wakeups() - before;
+            model->Stop();
+            wakeups_per_hour = wakeups * 3600.0 / idle.count();
+        }
+
+        std::uniform_int_distribution<int> phase(0, static_cast<int>(std::chrono::milliseconds{ kSlice }.count()) - 1);
+        std::vector<double> latencies;
+        for (int i = 0; i < trials; ++i)
+        {
+            const auto model = make();
+            model->Start();
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 100 + phase(random) });
+            const auto start = Clock::now();
+            model->Stop();
+            latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        double total = 0;
+        for (double latency : latencies)
+            total += latency;
+        std::printf("  %-22s %8.0f wakeups/hour  stop mean %8.1f ms  max %8.1f ms\n", name, wakeups_per_hour,
+                    total / latencies.size(), *std::max_element(latencies.begin(), latencies.end()));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::chrono::seconds idle{ argc > 1 ? std::atoi(argv[1]) : 60 };
+    const int trials = std::max(argc > 2 ? std::atoi(argv[2]) : 5, 1);
+    std::mt19937 random(1);
+
+    std::printf("%lld s idle, %d stops each, next run in %lld s\n", static_cast<long long>(idle.count()), trials,
+                static_cast<long long>(kInterval.count()));
+    std::printf("idle\n");
+    run("before: 5 s polling", [] { return std::make_unique<PollingIdle>(); }, idle, trials, random);
+    run("after: StopEvent", [] { return std::make_unique<EventIdle>(); }, idle, trials, random);
+    run("now: JobScheduler", [] { return std::make_unique<SchedulerIdle>(); }, idle, trials, random);
+    std::printf("updater running\n");
+    run("before: 5 s polling", [] { return std::make_unique<PollingUpdater>(); }, idle, trials, random);
+    run("after: StopEvent", [] { return std::make_unique<EventUpdater>(); }, idle, trials, random);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "stop_event.h"
+
+void StopEvent::Set()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        set_.store(true, std::memory_order_release);
+    }
+    cv_.notify_all();
+}
+
+void StopEvent::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    set_.store(false, std::memory_order_release);
+}
+
+bool StopEvent::WaitUntil(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_until(lock, deadline, [this] { return IsSet(); });
+}
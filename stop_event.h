@@ -0,0 +1,37 @@
+#ifndef STOP_EVENT_H
+#define STOP_EVENT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Manual reset event used to wake sleeping threads when the service stops.
+// Waiters sleep until their deadline or until Set(), whichever comes first,
+// so there are no periodic wake ups in between.
+class StopEvent
+{
+public:
+    StopEvent() = default;
+
+    StopEvent(const StopEvent&) = delete;
+    StopEvent& operator=(const StopEvent&) = delete;
+
+    void Set();
+    void Reset();
+    bool IsSet() const { return set_.load(std::memory_order_acquire); }
+
+    // Return true if the event was set, false on timeout.
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline);
+    bool WaitFor(std::chrono::steady_clock::duration timeout)
+    {
+        return WaitUntil(std::chrono::steady_clock::now() + timeout);
+    }
+
+private:
+    std::atomic<bool> set_{ false };
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+#endif
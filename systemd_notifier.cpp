@@ -0,0 +1,52 @@
+#include "systemd_notifier.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+SystemdNotifier::~SystemdNotifier()
+{
+    if (fd_ != -1)
+        close(fd_);
+}
+
+bool SystemdNotifier::Open()
+{
+    const char* watchdog_usec = std::getenv("WATCHDOG_USEC");
+    const char* watchdog_pid = std::getenv("WATCHDOG_PID");
+    // the watchdog is meant for whoever WATCHDOG_PID names, if set
+    if (watchdog_usec &&
+        (!watchdog_pid || std::strtoul(watchdog_pid, nullptr, 10) == static_cast<unsigned long>(getpid())))
+        watchdog_ = std::chrono::microseconds{ std::strtoull(watchdog_usec, nullptr, 10) };
+
+    const char* path = std::getenv("NOTIFY_SOCKET");
+    std::string socket_path{ path ? path : "" };
+    unsetenv("NOTIFY_SOCKET");
+    unsetenv("WATCHDOG_USEC");
+    unsetenv("WATCHDOG_PID");
+
+    if (socket_path.empty() || socket_path.size() >= sizeof address_.sun_path)
+        return false;
+    // abstract namespace socket
+    if (socket_path[0] == '@')
+        socket_path[0] = '\0';
+
+    address_.sun_family = AF_UNIX;
+    std::memcpy(address_.sun_path, socket_path.data(), socket_path.size());
+    address_size_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + socket_path.size());
+    if (socket_path[0] != '\0')
+        ++address_size_;
+
+    fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    return fd_ != -1;
+}
+
+bool SystemdNotifier::Notify(const std::string& state) const
+{
+    if (fd_ == -1 || state.empty())
+        return false;
+    const ssize_t sent = sendto(fd_, state.data(), state.size(), MSG_NOSIGNAL,
+                                reinterpret_cast<const sockaddr*>(&address_), address_size_);
+    return sent == static_cast<ssize_t>(state.size());
+}
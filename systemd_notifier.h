@@ -0,0 +1,42 @@
+#ifndef SYSTEMD_NOTIFIER_H
+#define SYSTEMD_NOTIFIER_H
+
+#include <chrono>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Speaks the sd_notify() protocol without linking libsystemd: state
+// strings such as "READY=1" are sent as datagrams to $NOTIFY_SOCKET.
+// Without that variable, e.g. when not started by systemd, every call is a
+// no-op.
+class SystemdNotifier
+{
+public:
+    SystemdNotifier() = default;
+    ~SystemdNotifier();
+
+    SystemdNotifier(const SystemdNotifier&) = delete;
+    SystemdNotifier& operator=(const SystemdNotifier&) = delete;
+
+    // Reads $NOTIFY_SOCKET and the watchdog settings and removes them from
+    // the environment so child processes don't talk to systemd on our
+    // behalf. Returns false if there is nothing to notify.
+    bool Open();
+
+    bool Enabled() const { return fd_ != -1; }
+
+    // Sends newline separated assignments, e.g. "READY=1\nSTATUS=Running".
+    bool Notify(const std::string& state) const;
+
+    // How often systemd expects "WATCHDOG=1", zero if it doesn't.
+    std::chrono::microseconds WatchdogInterval() const { return watchdog_; }
+
+private:
+    int fd_ = -1;
+    sockaddr_un address_{};
+    socklen_t address_size_ = 0;
+    std::chrono::microseconds watchdog_{ 0 };
+};
+
+#endif
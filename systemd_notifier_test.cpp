@@ -0,0 +1,233 @@
+// Drives SystemdNotifier and the POSIX ServiceBase lifecycle against a
+// datagram socket standing in for systemd's $NOTIFY_SOCKET. Linux only.
+//
+//   systemd_notifier_test
+
+#include "service_base.h"
+#include "systemd_notifier.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    int g_failures = 0;
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+    // how long systemd asks between pings, short so the test sees a few
+    const char* const kWatchdogUsec = "100000";
+    // the wait hint OnStop() reports, in milliseconds
+    const DWORD kStopWait = 5000;
+
+    // Stands in for systemd: a datagram socket in a temp dir that
+    // $NOTIFY_SOCKET points at.
+    class FakeSystemd
+    {
+    public:
+        FakeSystemd()
+        {
+            char dir[] = "/tmp/systemd_notifier_test.XXXXXX";
+            if (!mkdtemp(dir))
+            {
+                std::perror("mkdtemp");
+                std::exit(1);
+            }
+            dir_ = dir;
+            path_ = dir_ + "/notify.sock";
+
+            fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, path_.c_str(), sizeof address.sun_path - 1);
+            if (fd_ == -1 || bind(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof address) == -1)
+            {
+                std::perror(path_.c_str());
+                std::exit(1);
+            }
+            // a message that never comes fails the check instead of hanging
+            timeval timeout{ 2, 0 };
+            setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        }
+
+        ~FakeSystemd()
+        {
+            close(fd_);
+            unlink(path_.c_str());
+            rmdir(dir_.c_str());
+        }
+
+        // Sets what systemd would for a Type=notify unit with WatchdogSec=.
+        void Export(pid_t pid) const
+        {
+            setenv("NOTIFY_SOCKET", path_.c_str(), 1);
+            setenv("WATCHDOG_USEC", kWatchdogUsec, 1);
+            setenv("WATCHDOG_PID", std::to_string(pid).c_str(), 1);
+            // keeps the control socket out of /tmp
+            setenv("RUNTIME_DIRECTORY", dir_.c_str(), 1);
+        }
+
+        // Reads messages until one carries |assignment|, a whole line or a
+        // "NAME=" prefix. Returns that message, empty if none arrived.
+        std::string WaitFor(const std::string& assignment) const
+        {
+            char buffer[4096];
+            while (true)
+            {
+                const ssize_t size = recv(fd_, buffer, sizeof buffer, 0);
+                if (size <= 0)
+                    return {};
+                const std::string message(buffer, static_cast<std::size_t>(size));
+                if (has(message, assignment))
+                    return message;
+            }
+        }
+
+        static bool has(const std::string& message, const std::string& assignment)
+        {
+            const bool prefix = assignment.back() == '=';
+            std::size_t begin = 0;
+            while (begin <= message.size())
+            {
+                std::size_t end = message.find('\n', begin);
+                if (end == std::string::npos)
+                    end = message.size();
+                const std::string line = message.substr(begin, end - begin);
+                if (prefix ? line.compare(0, assignment.size(), assignment) == 0 : line == assignment)
+                    return true;
+                begin = end + 1;
+            }
+            return false;
+        }
+
+    private:
+        std::string dir_;
+        std::string path_;
+        int fd_ = -1;
+    };
+
+    class TestService : public ServiceBase
+    {
+    public:
+        TestService() : ServiceBase("systemd_notifier_test", "systemd_notifier_test", 0, 0, 0)
+        {
+        }
+
+        using ServiceBase::SetStatus;
+
+    protected:
+        void OnStart(DWORD /*argc*/, TCHAR* /*argv*/[]) override
+        {
+        }
+
+        void OnStop() override
+        {
+            SetStatus(SERVICE_STOP_PENDING, NO_ERROR, kStopWait);
+        }
+    };
+
+    bool environment_cleared()
+    {
+        return !std::getenv("NOTIFY_SOCKET") && !std::getenv("WATCHDOG_USEC") && !std::getenv("WATCHDOG_PID");
+    }
+
+    void test_not_under_systemd()
+    {
+        unsetenv("NOTIFY_SOCKET");
+        SystemdNotifier notifier;
+        CHECK(!notifier.Open());
+        CHECK(!notifier.Enabled());
+        CHECK(!notifier.Notify("READY=1"));
+        CHECK(notifier.WatchdogInterval().count() == 0);
+    }
+
+    void test_notifier()
+    {
+        FakeSystemd systemd;
+        systemd.Export(getpid());
+        SystemdNotifier notifier;
+        CHECK(notifier.Open());
+        CHECK(notifier.Enabled());
+        CHECK(notifier.WatchdogInterval() == std::chrono::microseconds{ std::atoi(kWatchdogUsec) });
+        CHECK(environment_cleared());
+        CHECK(notifier.Notify("WATCHDOG=1"));
+        CHECK(!systemd.WaitFor("WATCHDOG=1").empty());
+    }
+
+    void test_watchdog_for_another_process()
+    {
+        FakeSystemd systemd;
+        systemd.Export(getpid() + 1);
+        SystemdNotifier notifier;
+        CHECK(notifier.Open());
+        CHECK(notifier.WatchdogInterval().count() == 0);
+        CHECK(environment_cleared());
+    }
+
+    void test_service_lifecycle()
+    {
+        FakeSystemd systemd;
+        systemd.Export(getpid());
+
+        // the service blocks these in Run(), the test thread must not take
+        // the SIGTERM either
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+        TestService service;
+        bool result = false;
+        std::thread runner([&service, &result] { result = service.Run(); });
+
+        CHECK(FakeSystemd::has(systemd.WaitFor("READY=1"), "STATUS=Running"));
+        CHECK(environment_cleared());
+        CHECK(!systemd.WaitFor("WATCHDOG=1").empty());
+
+        kill(getpid(), SIGTERM);
+        CHECK(!systemd.WaitFor("STOPPING=1").empty());
+        const std::string extend = systemd.WaitFor("EXTEND_TIMEOUT_USEC=");
+        CHECK(FakeSystemd::has(extend, "EXTEND_TIMEOUT_USEC=" + std::to_string(kStopWait * 1000)));
+        runner.join();
+        CHECK(result);
+
+        // what ReportFailure() sends before it exits
+        service.SetStatus(SERVICE_STOPPED, ERROR_SERVICE_SPECIFIC_ERROR);
+        const std::string failed = systemd.WaitFor("EXIT_STATUS=");
+        CHECK(FakeSystemd::has(failed, "EXIT_STATUS=" + std::to_string(EXIT_FAILURE)));
+        CHECK(FakeSystemd::has(failed, "STATUS=Stopped, error " + std::to_string(ERROR_SERVICE_SPECIFIC_ERROR)));
+        CHECK(!FakeSystemd::has(failed, "ERRNO="));
+
+        unsetenv("RUNTIME_DIRECTORY");
+    }
+}
+
+int main()
+{
+    test_not_under_systemd();
+    test_notifier();
+    test_watchdog_for_another_process();
+    test_service_lifecycle();
+    if (g_failures != 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("systemd_notifier_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef REPROC_CAPTURE_HPP
+#define REPROC_CAPTURE_HPP
+
+#include <reproc++/export.hpp>
+#include <reproc++/reproc.hpp>
+#include <reproc++/sink.hpp>
+
+#include <cstddef>
+#include <system_error>
+#include <thread>
+
+namespace reproc
+{
+
+/*!
+Drains stdout and stderr of a started child process concurrently in two
+background threads, keeping the last `out_capacity` and `err_capacity` bytes of
+each in a `ring_sink`.
+
+Reading both streams at the same time prevents the child process from blocking
+on a full pipe while the parent waits for it to exit. Memory use is bounded by
+the capacities no matter how much output the child process produces.
+
+Example:
+
+```c++
+reproc::process updater;
+updater.start(args);
+
+reproc::capture output(updater, 64 * 1024, 64 * 1024);
+updater.wait(reproc::infinite, &exit_status);
+output.join();
+
+std::cout << output.err().str();
+```
+
+Both threads exit once the child process (and any descendants that inherited
+its output streams) has closed them. The capture must be joined or destroyed
+before `process` is destroyed.
+*/
+class capture
+{
+
+public:
+  /*! Starts draining `process`. Throws `std::system_error` if the background
+  threads can't be created. */
+  REPROCXX_EXPORT capture(reproc::process &process, std::size_t out_capacity,
+                          std::size_t err_capacity);
+
+  /*! Calls `join`. */
+  REPROCXX_EXPORT ~capture() noexcept;
+
+  capture(const capture &) = delete;
+  capture &operator=(const capture &) = delete;
+
+  /*! Waits until both streams are closed and returns the first error that
+  occurred while reading them (if any). `out` and `err` can only be accessed
+  after `join` has returned. */
+  REPROCXX_EXPORT std::error_code join();
+
+  const ring_sink &out() const noexcept { return out_; }
+  const ring_sink &err() const noexcept { return err_; }
+
+private:
+  ring_sink out_;
+  ring_sink err_;
+  std::error_code out_ec_;
+  std::error_code err_ec_;
+  std::thread out_thread_;
+  std::thread err_thread_;
+};
+
+} // namespace reproc
+
+#endif
@@ -31,6 +31,14 @@ enum class stream {
   err = 2
 };
 
+/*! See `REPROC_LAUNCH` */
+enum class launch {
+  /*! `REPROC_LAUNCH_DEFAULT` */
+  standard = 0,
+  /*! `REPROC_LAUNCH_SPAWN` */
+  spawn = 1
+};
+
 using milliseconds = std::chrono::duration<unsigned int, std::milli>;
 /*! See `REPROC_INFINITE` */
 REPROCXX_EXPORT extern const reproc::milliseconds infinite;
@@ -96,10 +104,11 @@ public:
   REPROCXX_EXPORT process(process &&) noexcept = default;
   REPROCXX_EXPORT process &operator=(process &&) noexcept = default;
 
-  /*! `reproc_start` */
+  /*! `reproc_start_with` */
   REPROCXX_EXPORT std::error_code
   start(int argc, const char *const *argv,
-        const char *working_directory = nullptr) noexcept;
+        const char *working_directory = nullptr,
+        reproc::launch launch = reproc::launch::standard) noexcept;
 
   /*!
   Overload of `start` for convenient usage from C++.
@@ -110,10 +119,13 @@ public:
 
   `working_directory` specifies the working directory. It is optional and
   defaults to `nullptr`.
+
+  `launch` selects how the child process is created, see `REPROC_LAUNCH`.
   */
   REPROCXX_EXPORT std::error_code
   start(const std::vector<std::string> &args,
-        const std::string *working_directory = nullptr);
+        const std::string *working_directory = nullptr,
+        reproc::launch launch = reproc::launch::standard);
 
   /*! `reproc_read` */
   REPROCXX_EXPORT std::error_code read(reproc::stream stream, void *buffer,
@@ -172,6 +184,9 @@ public:
   /*! `reproc_kill` */
   REPROCXX_EXPORT std::error_code kill() noexcept;
 
+  /*! `reproc_kill_group` */
+  REPROCXX_EXPORT std::error_code kill_group() noexcept;
+
   /*! `reproc_stop` */
   REPROCXX_EXPORT std::error_code stop(cleanup c1, reproc::milliseconds t1,
                                        cleanup c2, reproc::milliseconds t2,
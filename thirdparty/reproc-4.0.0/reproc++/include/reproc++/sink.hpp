@@ -3,8 +3,10 @@
 
 #include <reproc++/export.hpp>
 
+#include <cstddef>
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 namespace reproc
 {
@@ -31,6 +33,33 @@ public:
   REPROCXX_EXPORT bool operator()(const char *buffer, unsigned int size);
 };
 
+/*!
+Keeps the last `capacity` bytes of the output of a child process in a fixed
+size ring buffer. Memory use doesn't grow with the amount of output which makes
+it suitable for reporting the tail of the output of chatty child processes.
+*/
+class ring_sink
+{
+  std::vector<char> buffer_;
+  std::size_t next_;
+  std::size_t size_;
+  unsigned long long total_;
+
+public:
+  REPROCXX_EXPORT explicit ring_sink(std::size_t capacity);
+
+  REPROCXX_EXPORT bool operator()(const char *buffer, unsigned int size);
+
+  /*! Returns the retained output, oldest byte first. */
+  REPROCXX_EXPORT std::string str() const;
+
+  /*! Total amount of bytes received, including discarded ones. */
+  unsigned long long total() const noexcept { return total_; }
+
+  /*! True if part of the output was discarded. */
+  bool truncated() const noexcept { return total_ > size_; }
+};
+
 } // namespace reproc
 
 #endif
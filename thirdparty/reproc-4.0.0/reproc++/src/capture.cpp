@@ -0,0 +1,44 @@
+#include <reproc++/capture.hpp>
+
+namespace reproc
+{
+
+capture::capture(reproc::process &process, std::size_t out_capacity,
+                 std::size_t err_capacity)
+    : out_(out_capacity), err_(err_capacity)
+{
+  // Reading different streams of the same process from different threads is
+  // safe since each stream has its own pipe.
+  out_thread_ = std::thread([this, &process]() {
+    out_ec_ = process.drain(reproc::stream::out, out_);
+  });
+
+  try {
+    err_thread_ = std::thread([this, &process]() {
+      err_ec_ = process.drain(reproc::stream::err, err_);
+    });
+  } catch (...) {
+    out_thread_.join();
+    throw;
+  }
+}
+
+capture::~capture() noexcept
+{
+  join();
+}
+
+std::error_code capture::join()
+{
+  if (out_thread_.joinable()) {
+    out_thread_.join();
+  }
+
+  if (err_thread_.joinable()) {
+    err_thread_.join();
+  }
+
+  return out_ec_ ? out_ec_ : err_ec_;
+}
+
+} // namespace reproc
@@ -67,10 +67,12 @@ process::~process() noexcept
 }
 
 std::error_code process::start(int argc, const char *const *argv,
-                               const char *working_directory) noexcept
+                               const char *working_directory,
+                               reproc::launch launch) noexcept
 {
-  REPROC_ERROR error = reproc_start(process_.get(), argc, argv,
-                                    working_directory);
+  REPROC_ERROR error = reproc_start_with(process_.get(), argc, argv,
+                                         working_directory,
+                                         static_cast<REPROC_LAUNCH>(launch));
 
   std::error_code ec = reproc_error_to_error_code(error);
   if (!ec) {
@@ -81,7 +83,8 @@ std::error_code process::start(int argc, const char *const *argv,
 }
 
 std::error_code process::start(const std::vector<std::string> &args,
-                               const std::string *working_directory)
+                               const std::string *working_directory,
+                               reproc::launch launch)
 {
   // Turn `args` into array of C strings.
   auto argv = std::vector<const char *>(args.size() + 1);
@@ -99,7 +102,7 @@ std::error_code process::start(const std::vector<std::string> &args,
                                             : nullptr;
 
   std::error_code ec = start(argc, &argv[0] /* `std::vector` -> C array */,
-                             child_working_directory);
+                             child_working_directory, launch);
 
   return ec;
 }
@@ -165,6 +168,18 @@ std::error_code process::kill() noexcept
   return ec;
 }
 
+std::error_code process::kill_group() noexcept
+{
+  REPROC_ERROR error = reproc_kill_group(process_.get());
+
+  std::error_code ec = reproc_error_to_error_code(error);
+  if (!ec) {
+    running_ = false;
+  }
+
+  return ec;
+}
+
 std::error_code process::stop(cleanup c1, reproc::milliseconds t1,
                               unsigned int *exit_status) noexcept
 {
@@ -1,5 +1,6 @@
 #include <reproc++/sink.hpp>
 
+#include <algorithm>
 #include <ostream>
 
 namespace reproc
@@ -21,4 +22,50 @@ bool ostream_sink::operator()(const char *buffer, unsigned int size)
   return true;
 }
 
+ring_sink::ring_sink(std::size_t capacity)
+    : buffer_(capacity), next_(0), size_(0), total_(0)
+{
+}
+
+bool ring_sink::operator()(const char *buffer, unsigned int size)
+{
+  total_ += size;
+
+  std::size_t capacity = buffer_.size();
+  if (capacity == 0) {
+    return true;
+  }
+
+  // Only the last `capacity` bytes of `buffer` can survive.
+  if (size >= capacity) {
+    std::copy(buffer + (size - capacity), buffer + size, buffer_.data());
+    next_ = 0;
+    size_ = capacity;
+    return true;
+  }
+
+  std::size_t first = std::min<std::size_t>(size, capacity - next_);
+  std::copy(buffer, buffer + first, buffer_.data() + next_);
+  std::copy(buffer + first, buffer + size, buffer_.data());
+
+  next_ = (next_ + size) % capacity;
+  size_ = std::min(size_ + size, capacity);
+
+  return true;
+}
+
+std::string ring_sink::str() const
+{
+  std::string out;
+  out.reserve(size_);
+
+  std::size_t capacity = std::max<std::size_t>(buffer_.size(), 1);
+  std::size_t start = (next_ + capacity - size_) % capacity;
+  std::size_t first = std::min(size_, buffer_.size() - start);
+  out.append(buffer_.data() + start, first);
+  out.append(buffer_.data(), size_ - first);
+
+  return out;
+}
+
 } // namespace reproc
@@ -0,0 +1,64 @@
+#include <doctest.h>
+#include <reproc++/capture.hpp>
+#include <reproc++/reproc.hpp>
+#include <reproc++/sink.hpp>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("ring-sink")
+{
+  reproc::ring_sink ring(8);
+
+  ring("abc", 3);
+  REQUIRE_EQ(ring.str(), "abc");
+  REQUIRE(!ring.truncated());
+
+  ring("defgh", 5);
+  REQUIRE_EQ(ring.str(), "abcdefgh");
+
+  ring("ij", 2);
+  REQUIRE_EQ(ring.str(), "cdefghij");
+  REQUIRE(ring.truncated());
+
+  ring("0123456789", 10);
+  REQUIRE_EQ(ring.str(), "23456789");
+  REQUIRE_EQ(ring.total(), 20);
+}
+
+TEST_CASE("capture")
+{
+  // Large enough to block the child process many times over if a stream
+  // isn't read while the other one is.
+  static constexpr unsigned int MEGABYTES = 256;
+  static constexpr std::size_t CAPACITY = 4096;
+
+  reproc::process flood(reproc::kill, reproc::milliseconds(0));
+  std::vector<std::string> args{ FLOOD_PATH, std::to_string(MEGABYTES) };
+
+  std::error_code ec = flood.start(args);
+  REQUIRE(!ec);
+
+  reproc::capture output(flood, CAPACITY, CAPACITY);
+
+  unsigned int exit_status = 0;
+  ec = flood.wait(reproc::infinite, &exit_status);
+  REQUIRE(!ec);
+  REQUIRE((exit_status == 0));
+
+  ec = output.join();
+  REQUIRE(!ec);
+
+  static constexpr unsigned long long EXPECTED = MEGABYTES * 1024ULL * 1024ULL +
+                                                 13;
+
+  REQUIRE_EQ(output.out().total(), EXPECTED);
+  REQUIRE_EQ(output.err().total(), EXPECTED);
+
+  std::string out = output.out().str();
+  std::string err = output.err().str();
+  REQUIRE_EQ(out.size(), CAPACITY);
+  REQUIRE_EQ(err.size(), CAPACITY);
+  REQUIRE_EQ(out.substr(out.size() - 13), "END-OF-STDOUT");
+  REQUIRE_EQ(err.substr(err.size() - 13), "END-OF-STDERR");
+}
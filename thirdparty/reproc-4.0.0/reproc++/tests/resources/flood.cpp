@@ -0,0 +1,27 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Writes `argv[1]` MiB to both stdout and stderr, alternating between them, and
+// ends each stream with a recognizable marker.
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    return 1;
+  }
+
+  unsigned long megabytes = std::strtoul(argv[1], nullptr, 10);
+
+  static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+  std::vector<char> chunk(CHUNK_SIZE, 'x');
+
+  for (unsigned long i = 0; i < megabytes * 16; i++) {
+    std::fwrite(chunk.data(), 1, chunk.size(), stdout);
+    std::fwrite(chunk.data(), 1, chunk.size(), stderr);
+  }
+
+  std::fputs("END-OF-STDOUT", stdout);
+  std::fputs("END-OF-STDERR", stderr);
+
+  return 0;
+}
@@ -97,6 +97,32 @@ REPROC_EXPORT REPROC_ERROR reproc_start(reproc_type *process, int argc,
                                         const char *const *argv,
                                         const char *working_directory);
 
+/*! Selects how `reproc_start_with` creates the child process. */
+typedef enum {
+  /*! The default used by `reproc_start`: `vfork` + `exec` (POSIX) or
+  `CreateProcess` (Windows). */
+  REPROC_LAUNCH_DEFAULT = 0,
+  /*!
+  `posix_spawn` with file actions for the pipes and `closefrom` (implemented
+  with `close_range` where available) to close inherited file descriptors. The
+  C library creates the child with `clone(CLONE_VM | CLONE_VFORK)` so launch
+  cost doesn't depend on the size of the parent process.
+
+  Falls back to `REPROC_LAUNCH_DEFAULT` when the C library doesn't provide the
+  required extensions and on Windows.
+  */
+  REPROC_LAUNCH_SPAWN = 1
+} REPROC_LAUNCH;
+
+/*!
+Same as `reproc_start` but lets the caller select the process creation
+strategy with `launch`. Both strategies behave identically otherwise.
+*/
+REPROC_EXPORT REPROC_ERROR reproc_start_with(reproc_type *process, int argc,
+                                             const char *const *argv,
+                                             const char *working_directory,
+                                             REPROC_LAUNCH launch);
+
 /*!
 Reads up to `size` bytes from the child process stream indicated by `stream`
 (cannot be `REPROC_IN`) and stores them them in `buffer`. The amount of bytes
@@ -228,13 +254,13 @@ If the child process exits before the timeout expires and `exit_status` is not
 This function should not be called after one of `reproc_wait` or `reproc_stop`
 has returned `REPROC_SUCCESS` for that child process.
 
-Possible errors when `timeout` is 0 or `REPROC_INFINITE`:
+On POSIX, timed waits don't create any processes. On Linux a process file
+descriptor is polled when the kernel supports it, otherwise the child process
+is checked periodically until the timeout expires.
+
+Possible errors:
 - `REPROC_INTERRUPTED`
 - `REPROC_WAIT_TIMEOUT`
-
-Extra possible errors when `timeout` is not 0 or `REPROC_INFINITE` (POSIX only):
-- `REPROC_PROCESS_LIMIT_REACHED`
-- `REPROC_NOT_ENOUGH_MEMORY`
 */
 REPROC_EXPORT REPROC_ERROR reproc_wait(reproc_type *process,
                                        unsigned int timeout,
@@ -262,6 +288,25 @@ has returned `REPROC_SUCCESS` for that child process.
 */
 REPROC_EXPORT REPROC_ERROR reproc_kill(reproc_type *process);
 
+/*!
+Kills the child process together with the processes it started, such as
+grandchildren that inherited its output pipes and keep them open after the
+child process itself has exited.
+
+(POSIX) Sends the `SIGKILL` signal to the process group of the child process,
+which reproc always starts in a group of its own. This also works after the
+child process has exited and been waited for, as long as members of its group
+are left.
+
+(Windows) Calls `TerminateProcess` on the descendants of the child process and
+on the child process itself. Descendants are found by their parent process id,
+so processes whose parent has exited already are missed.
+
+Unlike `reproc_kill` this can be called after `reproc_wait` has returned
+`REPROC_SUCCESS`, until `reproc_destroy` is called.
+*/
+REPROC_EXPORT REPROC_ERROR reproc_kill_group(reproc_type *process);
+
 /*! Used to tell `reproc_stop` how to stop a child process. */
 typedef enum {
   /*! noop (no operation) */
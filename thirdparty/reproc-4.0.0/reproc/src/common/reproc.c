@@ -3,6 +3,14 @@
 #include <assert.h>
 #include <stdbool.h>
 
+REPROC_ERROR reproc_start(reproc_type *process, int argc,
+                          const char *const *argv,
+                          const char *working_directory)
+{
+  return reproc_start_with(process, argc, argv, working_directory,
+                           REPROC_LAUNCH_DEFAULT);
+}
+
 REPROC_ERROR reproc_stop(reproc_type *process, REPROC_CLEANUP c1,
                          unsigned int t1, REPROC_CLEANUP c2, unsigned int t2,
                          REPROC_CLEANUP c3, unsigned int t3,
@@ -7,11 +7,25 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdint.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(HAVE_POSIX_SPAWN_CLOSEFROM)
+#include <spawn.h>
+
+extern char **environ;
+#endif
+
 REPROC_ERROR process_create(int (*action)(const void *), const void *context,
                             struct process_options *options, pid_t *pid)
 {
@@ -127,6 +141,16 @@ REPROC_ERROR process_create(int (*action)(const void *), const void *context,
       _exit(errno);
     }
 
+    // Don't pass on signals blocked by the parent (for example to receive them
+    // through `signalfd`), the child would ignore `reproc_terminate` otherwise.
+    sigset_t unblocked;
+
+    if (sigemptyset(&unblocked) == -1 ||
+        pthread_sigmask(SIG_SETMASK, &unblocked, NULL) != 0) {
+      write(error_pipe_write, &errno, sizeof(errno));
+      _exit(errno);
+    }
+
     if (options->working_directory && chdir(options->working_directory) == -1) {
       write(error_pipe_write, &errno, sizeof(errno));
       _exit(errno);
@@ -284,6 +308,107 @@ cleanup:
   return REPROC_SUCCESS;
 }
 
+REPROC_ERROR process_spawn(const char *const *argv,
+                           struct process_options *options, pid_t *pid)
+{
+  assert(argv);
+  assert(options);
+  assert(pid);
+
+#if defined(HAVE_POSIX_SPAWN_CLOSEFROM)
+#if !defined(HAVE_POSIX_SPAWN_CHDIR)
+  if (options->working_directory) {
+    errno = ENOSYS;
+    return REPROC_UNKNOWN_ERROR;
+  }
+#endif
+
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attributes;
+  int result = 0;
+
+  result = posix_spawn_file_actions_init(&actions);
+  if (result != 0) {
+    errno = result;
+    return REPROC_UNKNOWN_ERROR;
+  }
+
+  result = posix_spawnattr_init(&attributes);
+  if (result != 0) {
+    posix_spawn_file_actions_destroy(&actions);
+    errno = result;
+    return REPROC_UNKNOWN_ERROR;
+  }
+
+  // File actions are executed in order so the pipe endpoints are duplicated
+  // onto the standard streams before every descriptor above stderr is closed.
+
+#if defined(HAVE_POSIX_SPAWN_CHDIR)
+  if (result == 0 && options->working_directory) {
+    result = posix_spawn_file_actions_addchdir_np(&actions,
+                                                  options->working_directory);
+  }
+#endif
+
+  if (result == 0 && options->stdin_fd) {
+    result = posix_spawn_file_actions_adddup2(&actions, options->stdin_fd,
+                                              STDIN_FILENO);
+  }
+  if (result == 0 && options->stdout_fd) {
+    result = posix_spawn_file_actions_adddup2(&actions, options->stdout_fd,
+                                              STDOUT_FILENO);
+  }
+  if (result == 0 && options->stderr_fd) {
+    result = posix_spawn_file_actions_adddup2(&actions, options->stderr_fd,
+                                              STDERR_FILENO);
+  }
+  if (result == 0) {
+    result = posix_spawn_file_actions_addclosefrom_np(&actions,
+                                                      STDERR_FILENO + 1);
+  }
+
+  // Same as in `process_create`, the child starts with no signals blocked.
+  sigset_t unblocked;
+  sigemptyset(&unblocked);
+
+  if (result == 0) {
+    result = posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP |
+                                                       POSIX_SPAWN_SETSIGMASK);
+  }
+  if (result == 0) {
+    result = posix_spawnattr_setpgroup(&attributes, options->process_group);
+  }
+  if (result == 0) {
+    result = posix_spawnattr_setsigmask(&attributes, &unblocked);
+  }
+
+  // `posix_spawnp` reports `exec` errors through its return value just like
+  // the error pipe does in `process_create`. The cast is safe since
+  // `posix_spawnp` doesn't change the contents of `argv`.
+  if (result == 0) {
+    result = posix_spawnp(pid, argv[0], &actions, &attributes,
+                          (char *const *) argv, environ);
+  }
+
+  posix_spawnattr_destroy(&attributes);
+  posix_spawn_file_actions_destroy(&actions);
+
+  if (result != 0) {
+    errno = result;
+    return REPROC_UNKNOWN_ERROR;
+  }
+
+  return REPROC_SUCCESS;
+#else
+  (void) argv;
+  (void) options;
+  (void) pid;
+
+  errno = ENOSYS;
+  return REPROC_UNKNOWN_ERROR;
+#endif
+}
+
 static unsigned int parse_exit_status(int status)
 {
   // `WEXITSTATUS` returns a value between [0,256) so casting to `unsigned int`
@@ -337,120 +462,128 @@ static REPROC_ERROR wait_infinite(pid_t pid, unsigned int *exit_status)
   return REPROC_SUCCESS;
 }
 
-// Makeshift C lambda which is passed to `process_create`.
-static int timeout_process(const void *context)
+static int64_t now_milliseconds(void)
 {
-  unsigned int milliseconds = *((const unsigned int *) context);
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-  struct timeval tv;
-  tv.tv_sec = milliseconds / 1000;           // ms -> s
-  tv.tv_usec = (milliseconds % 1000) * 1000; // leftover ms -> us
+#if defined(__linux__)
 
-  // `select` with no file descriptors can be used as a makeshift sleep function
-  // that can still be interrupted.
-  if (select(0, NULL, NULL, NULL, &tv) == -1) {
-    return errno;
-  }
+#if !defined(SYS_pidfd_open)
+#define SYS_pidfd_open 434
+#endif
 
-  return 0;
-}
-
-static REPROC_ERROR timeout_map_error(int error)
+// Waits for the child process to exit by polling a process file descriptor
+// (Linux 5.3+). Returns `REPROC_UNKNOWN_ERROR` with `errno` set to `ENOSYS`
+// if the kernel doesn't support `pidfd_open` so the caller can fall back.
+static REPROC_ERROR wait_pidfd(pid_t pid, unsigned int timeout,
+                               unsigned int *exit_status)
 {
-  switch (error) {
-  case EINTR:
-    return REPROC_INTERRUPTED;
-  case ENOMEM:
-    return REPROC_NOT_ENOUGH_MEMORY;
-  default:
+  int pidfd = (int) syscall(SYS_pidfd_open, pid, 0);
+  if (pidfd == -1) {
     return REPROC_UNKNOWN_ERROR;
   }
-}
 
-static REPROC_ERROR wait_timeout(pid_t pid, unsigned int timeout,
-                                 unsigned int *exit_status)
-{
-  assert(timeout > 0);
+  int64_t deadline = now_milliseconds() + timeout;
+  struct pollfd pfd = { .fd = pidfd, .events = POLLIN };
+  int result = 0;
 
-  REPROC_ERROR error = REPROC_SUCCESS;
+  while (true) {
+    int64_t remaining = deadline - now_milliseconds();
+    if (remaining < 0) {
+      remaining = 0;
+    }
 
-  // Check if the child process has already exited before starting a
-  // possibly expensive timeout process. If `wait_no_hang` doesn't time out we
-  // can return early.
-  error = wait_no_hang(pid, exit_status);
-  if (error != REPROC_WAIT_TIMEOUT) {
-    return error;
-  }
+    // `poll` takes an `int` so timeouts past `INT_MAX` milliseconds (about
+    // 24.8 days) are waited out in slices.
+    int slice = remaining > INT_MAX ? INT_MAX : (int) remaining;
+    result = poll(&pfd, 1, slice);
+    if (result == -1 && errno == EINTR) {
+      continue;
+    }
 
-  struct process_options options = {
-    // `waitpid` supports waiting for the first process that exits in a process
-    // group. To take advantage of this we put the timeout process in the same
-    // process group as the process we're waiting for.
-    .process_group = pid,
-    // Return early so `process_create` doesn't block until the timeout has
-    // expired.
-    .return_early = true,
-    // Don't `vfork` because when `vfork` is used the parent process is
-    // suspended until the child process calls `exec` or `_exit`.
-    // `timeout_process` doesn't call either which results in the parent process
-    // being suspended until the timeout process exits. This prevents the parent
-    // process from waiting until either the child process or the timeout
-    // process expires (which is what we need to do) so we don't use `vfork` to
-    // avoid this.
-    .vfork = false
-  };
-
-  pid_t timeout_pid = 0;
-  error = process_create(timeout_process, &timeout, &options, &timeout_pid);
-  if (error == REPROC_UNKNOWN_ERROR) {
-    error = timeout_map_error(errno);
-  }
+    if (result == 0 && remaining > slice) {
+      continue;
+    }
 
-  if (error) {
-    return error;
+    break;
   }
 
-  // Passing `-reproc->pid` to `waitpid` makes it wait for the first process in
-  // the `reproc->pid` process group to exit. The `reproc->pid` process group
-  // consists out of the child process we're waiting for and the timeout
-  // process. As a result, calling `waitpid` on the `reproc->pid` process group
-  // translates to waiting for either the child process or the timeout process
-  // to exit.
-  int status = 0;
-  pid_t exit_pid = waitpid(-pid, &status, 0);
+  int poll_error = errno;
+  fd_close(&pidfd);
 
-  // If the timeout process exits first the timeout will have expired.
-  if (exit_pid == timeout_pid) {
-    return REPROC_WAIT_TIMEOUT;
+  if (result == -1) {
+    errno = poll_error;
+    return REPROC_UNKNOWN_ERROR;
   }
 
-  // If the child process exits first we clean up the timeout process.
-  error = process_terminate(timeout_pid);
-  if (error) {
-    return error;
+  if (result == 0) {
+    return REPROC_WAIT_TIMEOUT;
   }
 
-  error = wait_infinite(timeout_pid, NULL);
-  if (error) {
-    return error;
-  }
+  // The child process has exited so this doesn't block.
+  return wait_infinite(pid, exit_status);
+}
 
-  // After cleaning up the timeout process we can check if `waitpid` returned an
-  // error.
-  if (exit_pid == -1) {
-    switch (errno) {
-    case EINTR:
-      return REPROC_INTERRUPTED;
-    default:
-      return REPROC_UNKNOWN_ERROR;
+#endif
+
+// Portable fallback: check the child process with `waitpid(WNOHANG)` and sleep
+// in between with an exponentially growing delay capped at
+// `WAIT_POLL_MAX_DELAY` milliseconds. We deliberately don't install a `SIGCHLD`
+// handler since that would replace the handler of the application embedding
+// reproc.
+#define WAIT_POLL_MAX_DELAY 20
+
+static REPROC_ERROR wait_poll(pid_t pid, unsigned int timeout,
+                              unsigned int *exit_status)
+{
+  int64_t deadline = now_milliseconds() + timeout;
+  int64_t delay = 1;
+
+  while (true) {
+    REPROC_ERROR error = wait_no_hang(pid, exit_status);
+    if (error != REPROC_WAIT_TIMEOUT) {
+      return error;
+    }
+
+    int64_t remaining = deadline - now_milliseconds();
+    if (remaining <= 0) {
+      return REPROC_WAIT_TIMEOUT;
     }
+
+    int64_t nap = delay < remaining ? delay : remaining;
+    struct timespec ts = { .tv_sec = (time_t)(nap / 1000),
+                           .tv_nsec = (long) (nap % 1000) * 1000000 };
+    // An interrupted sleep just results in an earlier check.
+    nanosleep(&ts, NULL);
+
+    delay = delay * 2 < WAIT_POLL_MAX_DELAY ? delay * 2 : WAIT_POLL_MAX_DELAY;
   }
+}
 
-  if (exit_status) {
-    *exit_status = parse_exit_status(status);
+static REPROC_ERROR wait_timeout(pid_t pid, unsigned int timeout,
+                                 unsigned int *exit_status)
+{
+  assert(timeout > 0);
+
+  // Check if the child process has already exited before setting anything up.
+  // If `wait_no_hang` doesn't time out we can return early.
+  REPROC_ERROR error = wait_no_hang(pid, exit_status);
+  if (error != REPROC_WAIT_TIMEOUT) {
+    return error;
   }
 
-  return REPROC_SUCCESS;
+#if defined(__linux__)
+  error = wait_pidfd(pid, timeout, exit_status);
+  // Older kernels don't have `pidfd_open`, in that case we use the fallback.
+  if (error != REPROC_UNKNOWN_ERROR || (errno != ENOSYS && errno != EPERM)) {
+    return error;
+  }
+#endif
+
+  return wait_poll(pid, timeout, exit_status);
 }
 
 REPROC_ERROR process_wait(pid_t pid, unsigned int timeout,
@@ -484,3 +617,15 @@ REPROC_ERROR process_kill(pid_t pid)
 
   return REPROC_SUCCESS;
 }
+
+REPROC_ERROR process_kill_group(pid_t pid)
+{
+  // The child process is the leader of its own process group (see
+  // `process_create`). The group id stays reserved while any member is left,
+  // even if the child process itself has been waited for.
+  if (kill(-pid, SIGKILL) == -1 && errno != ESRCH) {
+    return REPROC_UNKNOWN_ERROR;
+  }
+
+  return REPROC_SUCCESS;
+}
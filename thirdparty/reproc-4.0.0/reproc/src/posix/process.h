@@ -34,6 +34,14 @@ REPROC_ERROR
 process_create(int (*action)(const void *), const void *context,
                struct process_options *options, pid_t *pid);
 
+/* Starts `argv` with `posix_spawnp` using the working directory, process group
+and redirections from `options` (`action`, `return_early` and `vfork` are
+ignored) and closes all other inherited file descriptors in the child process.
+Returns `REPROC_UNKNOWN_ERROR` with `errno` set to `ENOSYS` if the C library
+doesn't support the required extensions. */
+REPROC_ERROR process_spawn(const char *const *argv,
+                           struct process_options *options, pid_t *pid);
+
 REPROC_ERROR process_wait(pid_t pid, unsigned int timeout,
                           unsigned int *exit_status);
 
@@ -41,4 +49,6 @@ REPROC_ERROR process_terminate(pid_t pid);
 
 REPROC_ERROR process_kill(pid_t pid);
 
+REPROC_ERROR process_kill_group(pid_t pid);
+
 #endif
@@ -53,9 +53,10 @@ static REPROC_ERROR exec_map_error(int error)
   }
 }
 
-REPROC_ERROR reproc_start(reproc_type *process, int argc,
-                          const char *const *argv,
-                          const char *working_directory)
+REPROC_ERROR reproc_start_with(reproc_type *process, int argc,
+                               const char *const *argv,
+                               const char *working_directory,
+                               REPROC_LAUNCH launch)
 {
   assert(process);
 
@@ -95,14 +96,26 @@ REPROC_ERROR reproc_start(reproc_type *process, int argc,
     .stdin_fd = child_stdin,
     .stdout_fd = child_stdout,
     .stderr_fd = child_stderr,
-    // We put the child process in its own process group which is needed by
-    // `wait_timeout` in `process.c` (see `wait_timeout` for extra information).
+    // We put the child process in its own process group so signals sent to
+    // the parent's process group (e.g. Ctrl-C) don't reach it.
     .process_group = 0,
     // Don't return early to make sure we receive errors reported by `exec`.
     .return_early = false,
     .vfork = true
   };
 
+  if (launch == REPROC_LAUNCH_SPAWN) {
+    error = process_spawn(argv, &options, &process->id);
+    // `ENOSYS` means the C library lacks the required `posix_spawn`
+    // extensions, use the default strategy instead.
+    if (error != REPROC_UNKNOWN_ERROR || errno != ENOSYS) {
+      if (error == REPROC_UNKNOWN_ERROR) {
+        error = exec_map_error(errno);
+      }
+      goto cleanup;
+    }
+  }
+
   // Fork a child process and call `exec`.
   error = process_create(exec_process, argv, &options, &process->id);
   if (error == REPROC_UNKNOWN_ERROR) {
@@ -198,6 +211,13 @@ REPROC_ERROR reproc_kill(reproc_type *process)
   return process_kill(process->id);
 }
 
+REPROC_ERROR reproc_kill_group(reproc_type *process)
+{
+  assert(process);
+
+  return process_kill_group(process->id);
+}
+
 void reproc_destroy(reproc_type *process)
 {
   assert(process);
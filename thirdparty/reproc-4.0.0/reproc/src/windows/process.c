@@ -2,10 +2,10 @@
 #include "handle.h"
 
 #include <assert.h>
-
-#if defined(HAVE_ATTRIBUTE_LIST)
 #include <stdlib.h>
+#include <tlhelp32.h>
 
+#if defined(HAVE_ATTRIBUTE_LIST)
 REPROC_ERROR
 static handle_inherit_list_create(HANDLE *handles, int amount,
                                   LPPROC_THREAD_ATTRIBUTE_LIST *result)
@@ -196,3 +196,84 @@ REPROC_ERROR process_kill(HANDLE process)
 
   return REPROC_SUCCESS;
 }
+
+static int pid_list_contains(const DWORD *list, size_t size, DWORD pid)
+{
+  for (size_t i = 0; i < size; i++) {
+    if (list[i] == pid) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+REPROC_ERROR process_kill_group(unsigned long pid, HANDLE process)
+{
+  assert(process);
+
+  // Windows has no process group that can be killed at once so the
+  // descendants are killed one by one. `process` stays open until
+  // `reproc_destroy` which keeps `pid` from being reused, so every process that
+  // names it as its parent was started by the child process.
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+  if (snapshot == INVALID_HANDLE_VALUE) {
+    return REPROC_UNKNOWN_ERROR;
+  }
+
+  size_t capacity = 16;
+  size_t size = 1;
+  DWORD *tree = malloc(capacity * sizeof(DWORD));
+  if (!tree) {
+    CloseHandle(snapshot);
+    return REPROC_NOT_ENOUGH_MEMORY;
+  }
+  tree[0] = pid;
+
+  // Every pass adds the children of the processes found so far.
+  int found = 1;
+  while (found) {
+    found = 0;
+    PROCESSENTRY32 entry;
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Process32First(snapshot, &entry); more;
+         more = Process32Next(snapshot, &entry)) {
+      if (!pid_list_contains(tree, size, entry.th32ParentProcessID) ||
+          pid_list_contains(tree, size, entry.th32ProcessID)) {
+        continue;
+      }
+
+      if (size == capacity) {
+        DWORD *grown = realloc(tree, 2 * capacity * sizeof(DWORD));
+        if (!grown) {
+          break;
+        }
+        tree = grown;
+        capacity *= 2;
+      }
+
+      tree[size++] = entry.th32ProcessID;
+      found = 1;
+    }
+  }
+
+  CloseHandle(snapshot);
+
+  for (size_t i = 1; i < size; i++) {
+    HANDLE descendant = OpenProcess(PROCESS_TERMINATE, FALSE, tree[i]);
+    if (descendant) {
+      TerminateProcess(descendant, 137);
+      CloseHandle(descendant);
+    }
+  }
+
+  free(tree);
+
+  // The child process might have exited already and only left descendants.
+  if (WaitForSingleObject(process, 0) != WAIT_OBJECT_0 &&
+      !TerminateProcess(process, 137)) {
+    return REPROC_UNKNOWN_ERROR;
+  }
+
+  return REPROC_SUCCESS;
+}
@@ -24,4 +24,6 @@ REPROC_ERROR process_terminate(unsigned long pid);
 
 REPROC_ERROR process_kill(HANDLE process);
 
+REPROC_ERROR process_kill_group(unsigned long pid, HANDLE process);
+
 #endif
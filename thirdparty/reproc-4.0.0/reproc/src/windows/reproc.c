@@ -9,12 +9,16 @@
 #include <stdlib.h>
 #include <windows.h>
 
-REPROC_ERROR reproc_start(reproc_type *process, int argc,
-                          const char *const *argv,
-                          const char *working_directory)
+REPROC_ERROR reproc_start_with(reproc_type *process, int argc,
+                               const char *const *argv,
+                               const char *working_directory,
+                               REPROC_LAUNCH launch)
 {
   assert(process);
 
+  // `CreateProcess` is the only way to create a process on Windows.
+  (void) launch;
+
   assert(argc > 0);
   assert(argv);
   assert(argv[argc] == NULL);
@@ -177,6 +181,13 @@ REPROC_ERROR reproc_kill(reproc_type *process)
   return process_kill(process->handle);
 }
 
+REPROC_ERROR reproc_kill_group(reproc_type *process)
+{
+  assert(process);
+
+  return process_kill_group(process->id, process->handle);
+}
+
 void reproc_destroy(reproc_type *process)
 {
   assert(process);
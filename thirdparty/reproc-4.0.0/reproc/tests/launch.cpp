@@ -0,0 +1,112 @@
+#include <doctest.h>
+#include <reproc/reproc.h>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+static long long launch_to_exit(REPROC_LAUNCH launch, unsigned int launches)
+{
+  static constexpr unsigned int ARGV_SIZE = 2;
+  std::array<const char *, ARGV_SIZE> argv{ { NOOP_PATH, nullptr } };
+
+  auto start = steady_clock::now();
+  for (unsigned int i = 0; i < launches; i++) {
+    reproc_type noop;
+    int error = reproc_start_with(&noop, ARGV_SIZE - 1, argv.data(), nullptr,
+                                  launch);
+    REQUIRE(!error);
+
+    error = reproc_wait(&noop, REPROC_INFINITE, nullptr);
+    REQUIRE(!error);
+
+    reproc_destroy(&noop);
+  }
+
+  return duration_cast<microseconds>(steady_clock::now() - start).count() /
+         launches;
+}
+
+TEST_CASE("launch")
+{
+  reproc_type io;
+
+  int error = REPROC_SUCCESS;
+  CAPTURE(error);
+
+  SUBCASE("spawn")
+  {
+    std::string message = "This is stdout";
+    auto message_length = static_cast<unsigned int>(message.length());
+
+    static constexpr unsigned int ARGV_SIZE = 2;
+    std::array<const char *, ARGV_SIZE> argv{ { STDOUT_PATH, nullptr } };
+
+    error = reproc_start_with(&io, ARGV_SIZE - 1, argv.data(), STDOUT_DIR,
+                              REPROC_LAUNCH_SPAWN);
+    REQUIRE(!error);
+
+    unsigned int bytes_written = 0;
+    error = reproc_write(&io, message.data(), message_length, &bytes_written);
+    REQUIRE(!error);
+
+    reproc_close(&io, REPROC_IN);
+
+    std::string output{};
+    std::array<char, 1024> buffer = { {} };
+
+    while (true) {
+      unsigned int bytes_read = 0;
+      error = reproc_read(&io, REPROC_OUT, buffer.data(),
+                          static_cast<unsigned int>(buffer.size()),
+                          &bytes_read);
+      if (error != REPROC_SUCCESS) {
+        break;
+      }
+
+      output.append(buffer.data(), bytes_read);
+    }
+
+    REQUIRE_EQ(output, message);
+
+    unsigned int exit_status = 0;
+    error = reproc_wait(&io, REPROC_INFINITE, &exit_status);
+    REQUIRE(!error);
+    REQUIRE((exit_status == 0));
+
+    reproc_destroy(&io);
+  }
+
+  SUBCASE("file not found")
+  {
+    static constexpr unsigned int ARGV_SIZE = 2;
+    std::array<const char *, ARGV_SIZE> argv{ { "reproc-does-not-exist",
+                                                nullptr } };
+
+    error = reproc_start_with(&io, ARGV_SIZE - 1, argv.data(), nullptr,
+                              REPROC_LAUNCH_SPAWN);
+    REQUIRE(error == REPROC_FILE_NOT_FOUND);
+  }
+
+  SUBCASE("latency")
+  {
+    static constexpr unsigned int LAUNCHES = 50;
+
+    // Launch cost of `fork` grows with the parent's resident memory, the
+    // `vfork` and `posix_spawn` strategies shouldn't.
+    static constexpr std::array<std::size_t, 3> RSS_MEGABYTES{ { 0, 64, 256 } };
+
+    for (std::size_t megabytes : RSS_MEGABYTES) {
+      std::vector<char> resident(megabytes << 20, 1);
+
+      long long standard = launch_to_exit(REPROC_LAUNCH_DEFAULT, LAUNCHES);
+      long long spawn = launch_to_exit(REPROC_LAUNCH_SPAWN, LAUNCHES);
+
+      MESSAGE("rss +" << megabytes << "MiB: default " << standard
+                      << "us, spawn " << spawn << "us per launch");
+    }
+  }
+}
@@ -3,6 +3,10 @@
 
 #include <array>
 
+#if !defined(_WIN32)
+#include <signal.h>
+#endif
+
 TEST_CASE("stop")
 {
   reproc_type infinite;
@@ -36,3 +40,43 @@ TEST_CASE("stop")
 
   reproc_destroy(&infinite);
 }
+
+#if !defined(_WIN32)
+TEST_CASE("stop-blocked-signals")
+{
+  // Services block signals to read them from a `signalfd`, children must
+  // still be stoppable.
+  sigset_t blocked;
+  sigset_t old_mask;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGTERM);
+  REQUIRE(pthread_sigmask(SIG_BLOCK, &blocked, &old_mask) == 0);
+
+  static constexpr unsigned int ARGV_SIZE = 2;
+  std::array<const char *, ARGV_SIZE> argv{ { INFINITE_PATH, nullptr } };
+
+  REPROC_LAUNCH launch = REPROC_LAUNCH_DEFAULT;
+  SUBCASE("default") { launch = REPROC_LAUNCH_DEFAULT; }
+  SUBCASE("spawn") { launch = REPROC_LAUNCH_SPAWN; }
+
+  reproc_type infinite;
+
+  int error = REPROC_SUCCESS;
+  CAPTURE(error);
+
+  error = reproc_start_with(&infinite, ARGV_SIZE - 1, argv.data(), nullptr,
+                            launch);
+  REQUIRE(!error);
+
+  error = reproc_terminate(&infinite);
+  REQUIRE(!error);
+
+  unsigned int exit_status = 0;
+  error = reproc_wait(&infinite, 1000, &exit_status);
+  REQUIRE(!error);
+  REQUIRE(exit_status == SIGTERM);
+
+  reproc_destroy(&infinite);
+  pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+}
+#endif
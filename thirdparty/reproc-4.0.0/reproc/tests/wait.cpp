@@ -0,0 +1,89 @@
+#include <doctest.h>
+#include <reproc/reproc.h>
+
+#include <array>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono;
+
+TEST_CASE("wait")
+{
+  reproc_type process;
+
+  int error = REPROC_SUCCESS;
+  CAPTURE(error);
+
+  SUBCASE("timeout")
+  {
+    static constexpr unsigned int ARGV_SIZE = 2;
+    std::array<const char *, ARGV_SIZE> argv{ { INFINITE_PATH, nullptr } };
+
+    error = reproc_start(&process, ARGV_SIZE - 1, argv.data(), nullptr);
+    REQUIRE(!error);
+
+    static constexpr unsigned int WAITS = 20;
+    static constexpr unsigned int TIMEOUT = 10;
+
+    auto start = steady_clock::now();
+    for (unsigned int i = 0; i < WAITS; i++) {
+      error = reproc_wait(&process, TIMEOUT, nullptr);
+      REQUIRE(error == REPROC_WAIT_TIMEOUT);
+    }
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+
+    // Every timed wait should take about as long as its timeout.
+    auto overhead = elapsed.count() / WAITS - TIMEOUT * 1000;
+    MESSAGE("timed wait overhead: " << overhead << "us per wait");
+    REQUIRE(elapsed >= milliseconds(WAITS * TIMEOUT));
+
+    error = reproc_kill(&process);
+    REQUIRE(!error);
+
+    error = reproc_wait(&process, REPROC_INFINITE, nullptr);
+    REQUIRE(!error);
+  }
+
+  SUBCASE("exit during wait")
+  {
+    static constexpr unsigned int ARGV_SIZE = 2;
+    std::array<const char *, ARGV_SIZE> argv{ { INFINITE_PATH, nullptr } };
+
+    error = reproc_start(&process, ARGV_SIZE - 1, argv.data(), nullptr);
+    REQUIRE(!error);
+
+    static constexpr unsigned int DELAY = 50;
+
+    // `reproc_kill` only sends a signal so it's safe to call from another
+    // thread while we're waiting on the process.
+    std::thread killer([&process]() {
+      std::this_thread::sleep_for(milliseconds(DELAY));
+      reproc_kill(&process);
+    });
+
+    auto start = steady_clock::now();
+    error = reproc_wait(&process, 5000, nullptr);
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+    killer.join();
+
+    REQUIRE(!error);
+    MESSAGE("wake up latency: " << elapsed.count() - DELAY * 1000 << "us");
+    REQUIRE(elapsed < milliseconds(1000));
+  }
+
+  SUBCASE("exited")
+  {
+    static constexpr unsigned int ARGV_SIZE = 2;
+    std::array<const char *, ARGV_SIZE> argv{ { NOOP_PATH, nullptr } };
+
+    error = reproc_start(&process, ARGV_SIZE - 1, argv.data(), nullptr);
+    REQUIRE(!error);
+
+    unsigned int exit_status = 1;
+    error = reproc_wait(&process, 5000, &exit_status);
+    REQUIRE(!error);
+    REQUIRE((exit_status == 0));
+  }
+
+  reproc_destroy(&process);
+}
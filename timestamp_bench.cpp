@@ -0,0 +1,54 @@
+// Times formatting event timestamps: format_timestamp() against the
+// std::time + localtime + strftime the service used before, and with the
+// clock read left out, both within one second, where only the fraction is
+// formatted, and with every timestamp in a new second.
+//
+//   timestamp_bench [timestamps]
+
+#include "host_clock.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace
+{
+    // Keeps the optimizer from dropping the formatting.
+    volatile std::size_t g_sizes = 0;
+
+    template <typename Format>
+    void run(const char* name, std::size_t count, Format format)
+    {
+        char buf[64];
+        std::size_t sizes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i)
+            sizes += format(buf, i);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        g_sizes += sizes;
+        std::printf("  %-28s %12.0f timestamps/s  %6.1f ns each\n", name, count / elapsed.count(),
+                    elapsed.count() * 1e9 / count);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace std::chrono;
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    const system_clock::time_point base = system_clock::now();
+
+    std::printf("%zu timestamps\n", count);
+    run("time + localtime + strftime", count / 10, [](char* buf, std::size_t) {
+        const std::time_t timestamp = std::time(nullptr);
+        return std::strftime(buf, 32, "%Y-%m-%dT%H:%M:%S.00000%z", std::localtime(&timestamp));
+    });
+    run("format_timestamp()", count, [](char* buf, std::size_t) { return format_timestamp(buf); });
+    run("format only, same second", count, [&](char* buf, std::size_t i) {
+        return format_timestamp(buf, base + microseconds{ i % 1000 });
+    });
+    run("format only, new second", count, [&](char* buf, std::size_t i) {
+        return format_timestamp(buf, base + seconds{ i });
+    });
+    return 0;
+}
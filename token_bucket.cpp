@@ -0,0 +1,35 @@
+#include "token_bucket.h"
+
+#include <algorithm>
+
+void TokenBucket::Reset(double rate, double burst)
+{
+    if (rate <= 0)
+    {
+        interval_ = 0;
+        return;
+    }
+    const std::chrono::duration<double> interval(1 / rate);
+    interval_ = std::max<int64_t>(std::chrono::duration_cast<Clock::duration>(interval).count(), 1);
+    tolerance_ = static_cast<int64_t>((std::max(burst, 1.0) - 1) * interval_);
+    full_at_.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+bool TokenBucket::Take(Clock::time_point now)
+{
+    if (Unlimited())
+        return true;
+
+    const int64_t t = now.time_since_epoch().count();
+    int64_t full_at = full_at_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        // each token moves it one interval later, the bucket is empty once
+        // it's more than a burst ahead
+        const int64_t start = std::max(full_at, t);
+        if (start - t > tolerance_)
+            return false;
+        if (full_at_.compare_exchange_weak(full_at, start + interval_, std::memory_order_relaxed))
+            return true;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Rate limit allowing |rate| events per second on average and bursts of up
+// to |burst| events. A zero rate lets everything through.
+// Kept as the generic cell rate algorithm's theoretical arrival time in a
+// single atomic, so Take() is lock free and safe from any thread.
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket() = default;
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    // Not thread safe, call before the first Take().
+    void Reset(double rate, double burst);
+
+    bool Unlimited() const { return interval_ == 0; }
+
+    // Takes one token, false if none is left.
+    bool Take(Clock::time_point now);
+
+private:
+    // Time per token and how far ahead of it a burst may run, in clock ticks.
+    int64_t interval_ = 0;
+    int64_t tolerance_ = 0;
+    // When the bucket is full again.
+    std::atomic<int64_t> full_at_{ 0 };
+};
+
+#endif
@@ -0,0 +1,717 @@
+#include "updater_config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <experimental/filesystem>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <sstream>
+#include <streambuf>
+
+#include "json.hpp"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    using json = nlohmann::json;
+
+    // Longest duration any setting takes. Deadlines are computed from them
+    // with nanosecond clocks, which this keeps far from overflowing.
+    const std::chrono::hours kMaxDuration{ 30 * 24 };
+
+    // Stream buffer over the config text that tells how far the parser got,
+    // json.hpp doesn't report positions to SAX handlers itself.
+    class PositionBuffer : public std::streambuf
+    {
+    public:
+        explicit PositionBuffer(const std::string& text)
+        {
+            // only ever read from
+            char* begin = const_cast<char*>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+
+        std::size_t Position() const { return static_cast<std::size_t>(gptr() - eback()); }
+    };
+
+    // Maps config_updater.json straight into an UpdaterConfig while it is
+    // parsed, without building a DOM. Parsing goes on after a bad value so
+    // every violation is reported, each with its key path and position.
+    // Unknown keys are skipped with a warning.
+    class ConfigBinder : public nlohmann::json_sax<json>
+    {
+    public:
+        ConfigBinder(const std::string& filename, const std::string& text, const PositionBuffer& buffer,
+                     UpdaterConfig& config, std::vector<std::string>& errors, std::vector<std::string>& warnings)
+            : filename_(filename)
+            , text_(text)
+            , buffer_(buffer)
+            , config_(config)
+            , errors_(errors)
+            , warnings_(warnings)
+        {
+        }
+
+        bool null() override { return Bind({ Kind::Null }); }
+        bool boolean(bool val) override
+        {
+            Value value{ Kind::Boolean };
+            value.boolean = val;
+            return Bind(value);
+        }
+        bool number_integer(number_integer_t val) override
+        {
+            // only negative numbers end up here
+            Value value{ Kind::Integer };
+            value.integer = val;
+            return Bind(value);
+        }
+        bool number_unsigned(number_unsigned_t val) override
+        {
+            Value value{ Kind::Unsigned };
+            value.number = val;
+            return Bind(value);
+        }
+        bool number_float(number_float_t, const string_t&) override { return Bind({ Kind::Float }); }
+        bool string(string_t& val) override
+        {
+            Value value{ Kind::String };
+            value.text = &val;
+            return Bind(value);
+        }
+
+        bool start_object(std::size_t) override;
+        bool key(string_t& val) override;
+        bool end_object() override;
+        bool start_array(std::size_t) override;
+        bool end_array() override;
+        bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override;
+
+    private:
+        enum class Frame
+        {
+            Root,
+            Jobs,
+            Job,
+            // "args" given as an array of strings
+            Args,
+            // a value nobody asked for, or of the wrong type
+            Skip
+        };
+
+        enum class Kind
+        {
+            Null,
+            Boolean,
+            Integer,
+            Unsigned,
+            Float,
+            String,
+            Object,
+            Array
+        };
+
+        struct Value
+        {
+            Kind kind;
+            bool boolean = false;
+            int64_t integer = 0;
+            uint64_t number = 0;
+            std::string* text = nullptr;
+        };
+
+        // Keys a job can't do without, as bits.
+        enum Required : unsigned
+        {
+            kUpdater = 1,
+            kArgs = 2,
+            kInterval = 4
+        };
+
+        bool Bind(const Value& value);
+        void BindRoot(const Value& value);
+        // Returns false if key_ isn't a job setting.
+        bool BindJob(JobConfig& job, unsigned& seen, const Value& value);
+        void FinishJob(unsigned seen, const std::string& path);
+        void FinishRoot();
+
+        void String(const Value& value, std::string& out);
+        void Boolean(const Value& value, bool& out);
+        void Integer(const Value& value, int& out);
+        template <typename T>
+        void Unsigned(const Value& value, T& out);
+        template <typename Duration>
+        void Count(const Value& value, Duration& out);
+
+        void Mismatch(const char* expected, const Value& value);
+        void Violation(const std::string& message) { errors_.push_back(Where(buffer_.Position()) + message); }
+        std::string Where(std::size_t position) const;
+        std::string Path() const;
+
+        const std::string filename_;
+        const std::string& text_;
+        const PositionBuffer& buffer_;
+        UpdaterConfig& config_;
+        std::vector<std::string>& errors_;
+        std::vector<std::string>& warnings_;
+
+        std::vector<Frame> stack_;
+        std::size_t skip_depth_ = 0;
+        std::string key_;
+        bool has_name_ = false;
+        bool has_jobs_ = false;
+        // Updater settings at the top level, from before jobs were supported.
+        JobConfig root_job_;
+        unsigned root_seen_ = 0;
+        JobConfig job_;
+        unsigned job_seen_ = 0;
+        // The job whose "args" array is being read.
+        JobConfig* args_job_ = nullptr;
+        std::size_t args_index_ = 0;
+    };
+
+    bool ConfigBinder::start_object(std::size_t)
+    {
+        if (stack_.empty())
+        {
+            stack_.push_back(Frame::Root);
+            return true;
+        }
+
+        switch (stack_.back())
+        {
+        case Frame::Jobs:
+            job_ = JobConfig{};
+            job_.name = "job" + std::to_string(config_.jobs.size());
+            job_seen_ = 0;
+            stack_.push_back(Frame::Job);
+            key_.clear();
+            return true;
+        case Frame::Skip:
+            ++skip_depth_;
+            return true;
+        default:
+            Bind({ Kind::Object });
+            stack_.push_back(Frame::Skip);
+            skip_depth_ = 1;
+            return true;
+        }
+    }
+
+    bool ConfigBinder::key(string_t& val)
+    {
+        if (stack_.back() != Frame::Skip)
+            key_.assign(val);
+        return true;
+    }
+
+    bool ConfigBinder::end_object()
+    {
+        switch (stack_.back())
+        {
+        case Frame::Skip:
+            if (--skip_depth_ == 0)
+                stack_.pop_back();
+            break;
+        case Frame::Job:
+            stack_.pop_back();
+            FinishJob(job_seen_, "jobs[" + std::to_string(config_.jobs.size()) + "]");
+            config_.jobs.push_back(std::move(job_));
+            break;
+        default:
+            stack_.pop_back();
+            FinishRoot();
+            break;
+        }
+        return true;
+    }
+
+    bool ConfigBinder::start_array(std::size_t)
+    {
+        if (!stack_.empty() && stack_.back() == Frame::Skip)
+        {
+            ++skip_depth_;
+            return true;
+        }
+        if (!stack_.empty() && stack_.back() == Frame::Root && key_ == "jobs")
+        {
+            has_jobs_ = true;
+            config_.jobs.clear();
+            stack_.push_back(Frame::Jobs);
+            return true;
+        }
+        if (!stack_.empty() && (stack_.back() == Frame::Root || stack_.back() == Frame::Job) && key_ == "args")
+        {
+            const bool root = stack_.back() == Frame::Root;
+            args_job_ = root ? &root_job_ : &job_;
+            (root ? root_seen_ : job_seen_) |= kArgs;
+            args_job_->updater_arguments.clear();
+            args_index_ = 0;
+            stack_.push_back(Frame::Args);
+            return true;
+        }
+        Bind({ Kind::Array });
+        stack_.push_back(Frame::Skip);
+        skip_depth_ = 1;
+        return true;
+    }
+
+    bool ConfigBinder::end_array()
+    {
+        if (stack_.back() == Frame::Skip)
+        {
+            if (--skip_depth_ == 0)
+                stack_.pop_back();
+        }
+        else
+        {
+            stack_.pop_back();
+        }
+        return true;
+    }
+
+    bool ConfigBinder::parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex)
+    {
+        // drop json.hpp's own prefix, the position is added in the same
+        // format as for every other error
+        const char* message = ex.what();
+        if (const char* colon = std::strstr(message, ": "))
+            message = colon + 2;
+        errors_.push_back(Where(position) + message);
+        return false;
+    }
+
+    bool ConfigBinder::Bind(const Value& value)
+    {
+        if (stack_.empty())
+        {
+            Mismatch("an object", value);
+            return true;
+        }
+
+        switch (stack_.back())
+        {
+        case Frame::Root:
+            BindRoot(value);
+            break;
+        case Frame::Jobs:
+            Mismatch("an object", value);
+            break;
+        case Frame::Args:
+            if (value.kind == Kind::String)
+                args_job_->updater_arguments.push_back(std::move(*value.text));
+            else
+                Mismatch("a string", value);
+            ++args_index_;
+            break;
+        case Frame::Job:
+            if (key_ == "name")
+                String(value, job_.name);
+            else if (!BindJob(job_, job_seen_, value))
+                warnings_.push_back(Where(buffer_.Position()) + Path() + ": unknown key, ignored");
+            break;
+        case Frame::Skip:
+            break;
+        }
+        return true;
+    }
+
+    void ConfigBinder::BindRoot(const Value& value)
+    {
+        LogShipper::Options& log_options = config_.log_options;
+        if (key_ == "name")
+        {
+            String(value, config_.name);
+            has_name_ = true;
+        }
+        else if (key_ == "jobs")
+        {
+            Mismatch("an array", value);
+        }
+        else if (key_ == "max_concurrent_jobs")
+        {
+            Unsigned(value, config_.max_concurrent_jobs);
+        }
+        else if (key_ == "watchdog_action")
+        {
+            std::string action;
+            String(value, action);
+            if (action == "restart_job")
+                config_.stall_action = StallAction::RestartJob;
+            else if (action == "fail_service")
+                config_.stall_action = StallAction::FailService;
+            else if (action == "log")
+                config_.stall_action = StallAction::Log;
+            else if (value.kind == Kind::String)
+                warnings_.push_back(Where(buffer_.Position()) + "Unknown watchdog_action: " + action);
+        }
+        else if (key_ == "watchdog_grace_s")
+            Count(value, config_.watchdog_grace);
+        else if (key_ == "user")
+            String(value, config_.user);
+        else if (key_ == "pass")
+            String(value, config_.pass);
+        else if (key_ == "log_server")
+            String(value, config_.log_server);
+        else if (key_ == "log_batch_size")
+            Unsigned(value, log_options.batch_size);
+        else if (key_ == "log_linger_ms")
+            Count(value, log_options.linger);
+        else if (key_ == "log_queue_size")
+            Unsigned(value, log_options.queue_capacity);
+        else if (key_ == "log_max_in_flight")
+            Unsigned(value, log_options.max_in_flight);
+        else if (key_ == "log_overflow")
+        {
+            std::string overflow;
+            String(value, overflow);
+            if (overflow == "drop_newest")
+                log_options.overflow = LogShipper::Overflow::DropNewest;
+            else if (overflow == "drop_oldest")
+                log_options.overflow = LogShipper::Overflow::DropOldest;
+            else if (overflow == "drop_debug_first")
+                log_options.overflow = LogShipper::Overflow::DropDebugFirst;
+            else if (overflow == "block")
+                log_options.overflow = LogShipper::Overflow::Block;
+            else if (overflow == "spill")
+                log_options.overflow = LogShipper::Overflow::Spill;
+            else if (value.kind == Kind::String)
+                warnings_.push_back(Where(buffer_.Position()) + "Unknown log_overflow: " + overflow);
+        }
+        else if (key_ == "log_block_ms")
+            Count(value, log_options.block_timeout);
+        else if (key_ == "log_rate_debug")
+            Unsigned(value, log_options.rate_limit[static_cast<std::size_t>(LogShipper::Level::Debug)]);
+        else if (key_ == "log_rate_information")
+            Unsigned(value, log_options.rate_limit[static_cast<std::size_t>(LogShipper::Level::Information)]);
+        else if (key_ == "log_rate_warning")
+            Unsigned(value, log_options.rate_limit[static_cast<std::size_t>(LogShipper::Level::Warning)]);
+        else if (key_ == "log_rate_error")
+            Unsigned(value, log_options.rate_limit[static_cast<std::size_t>(LogShipper::Level::Error)]);
+        else if (key_ == "log_coalesce_s")
+        {
+            std::chrono::seconds window{ 0 };
+            Count(value, window);
+            log_options.coalesce_window = window;
+        }
+        else if (key_ == "log_coalesce_keys")
+            Unsigned(value, log_options.coalesce_capacity);
+        else if (key_ == "log_retry_s")
+        {
+            std::chrono::seconds retry{ 0 };
+            Count(value, retry);
+            log_options.retry_interval = retry;
+        }
+        else if (key_ == "log_gzip")
+            Boolean(value, log_options.gzip);
+        else if (key_ == "log_h2c")
+            Boolean(value, config_.log_h2c);
+        else if (key_ == "log_gzip_level")
+            Integer(value, log_options.gzip_level);
+        else if (key_ == "log_spool_max_mb")
+        {
+            uint64_t megabytes = config_.log_spool_max_bytes >> 20;
+            Unsigned(value, megabytes);
+            if (megabytes > std::numeric_limits<uint64_t>::max() >> 20)
+                Violation(Path() + ": too large");
+            else
+                config_.log_spool_max_bytes = megabytes << 20;
+        }
+        else if (!BindJob(root_job_, root_seen_, value))
+            warnings_.push_back(Where(buffer_.Position()) + Path() + ": unknown key, ignored");
+    }
+
+    bool ConfigBinder::BindJob(JobConfig& job, unsigned& seen, const Value& value)
+    {
+        SchedulePolicy::Options& schedule = job.schedule;
+        if (key_ == "updater")
+        {
+            String(value, job.updater_filepath);
+            seen |= kUpdater;
+        }
+        else if (key_ == "args")
+        {
+            // the array form arrives through start_array()
+            std::string args;
+            String(value, args);
+            std::string error;
+            job.updater_arguments.clear();
+            if (!split_arguments(args, job.updater_arguments, error))
+                Violation(Path() + ": " + error);
+            seen |= kArgs;
+        }
+        else if (key_ == "interval")
+        {
+            Count(value, schedule.interval);
+            if (schedule.interval < 5s)
+                schedule.interval = 5s;
+            seen |= kInterval;
+        }
+        else if (key_ == "splay")
+            Count(value, schedule.splay);
+        else if (key_ == "jitter")
+            Count(value, schedule.jitter);
+        else if (key_ == "max_backoff")
+            Count(value, schedule.max_backoff);
+        else if (key_ == "after_update_interval")
+            Count(value, schedule.after_update);
+        else if (key_ == "precheck")
+            Boolean(value, job.precheck);
+        else if (key_ == "precheck_max_skip_s")
+            Count(value, job.precheck_max_skip);
+        else if (key_ == "feed")
+            String(value, job.feed);
+        else if (key_ == "feed_credentials")
+            String(value, job.feed_credentials);
+        else
+            return false;
+        return true;
+    }
+
+    void ConfigBinder::FinishJob(unsigned seen, const std::string& path)
+    {
+        static const struct
+        {
+            unsigned bit;
+            const char* key;
+        } kKeys[] = { { kUpdater, "updater" }, { kArgs, "args" }, { kInterval, "interval" } };
+        for (const auto& required : kKeys)
+        {
+            if ((seen & required.bit) == 0)
+                Violation(path + ": missing \"" + required.key + "\"");
+        }
+    }
+
+    void ConfigBinder::FinishRoot()
+    {
+        if (!has_name_)
+            Violation("missing \"name\"");
+        if (has_jobs_)
+            return;
+        // single updater config from before jobs were supported
+        root_job_.name = config_.name;
+        FinishJob(root_seen_, "top level");
+        config_.jobs.push_back(std::move(root_job_));
+    }
+
+    void ConfigBinder::String(const Value& value, std::string& out)
+    {
+        if (value.kind != Kind::String)
+            return Mismatch("a string", value);
+        out = std::move(*value.text);
+    }
+
+    void ConfigBinder::Boolean(const Value& value, bool& out)
+    {
+        if (value.kind != Kind::Boolean)
+            return Mismatch("true or false", value);
+        out = value.boolean;
+    }
+
+    void ConfigBinder::Integer(const Value& value, int& out)
+    {
+        if (value.kind == Kind::Integer && value.integer >= std::numeric_limits<int>::min())
+            out = static_cast<int>(value.integer);
+        else if (value.kind == Kind::Unsigned && value.number <= static_cast<uint64_t>(std::numeric_limits<int>::max()))
+            out = static_cast<int>(value.number);
+        else if (value.kind == Kind::Integer || value.kind == Kind::Unsigned)
+            Violation(Path() + ": out of range");
+        else
+            Mismatch("an integer", value);
+    }
+
+    template <typename T>
+    void ConfigBinder::Unsigned(const Value& value, T& out)
+    {
+        if (value.kind != Kind::Unsigned)
+            return Mismatch("a non-negative integer", value);
+        if (value.number > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+            return Violation(Path() + ": out of range");
+        out = static_cast<T>(value.number);
+    }
+
+    template <typename Duration>
+    void ConfigBinder::Count(const Value& value, Duration& out)
+    {
+        if (value.kind != Kind::Unsigned)
+            return Mismatch("a non-negative integer", value);
+        if (value.number > static_cast<uint64_t>(std::chrono::duration_cast<Duration>(kMaxDuration).count()))
+            return Violation(Path() + ": out of range, at most 30 days");
+        out = Duration{ static_cast<typename Duration::rep>(value.number) };
+    }
+
+    void ConfigBinder::Mismatch(const char* expected, const Value& value)
+    {
+        static const char* const kNames[] = {
+            "null", "a boolean", "a negative number", "a non-negative integer",
+            "a floating-point number", "a string", "an object", "an array"
+        };
+        std::string message = Path();
+        if (!message.empty())
+            message += ": ";
+        message += std::string("expected ") + expected + ", got " + kNames[static_cast<int>(value.kind)];
+        Violation(message);
+    }
+
+    std::string ConfigBinder::Where(std::size_t position) const
+    {
+        // the last character read, i.e. where the offending value ends (or
+        // the character right after a number)
+        std::size_t line = 1;
+        std::size_t line_start = 0;
+        const std::size_t end = std::min(position, text_.size());
+        for (std::size_t i = 0; i < end; ++i)
+        {
+            if (text_[i] == '\n')
+            {
+                ++line;
+                line_start = i + 1;
+            }
+        }
+        const std::size_t column = end > line_start ? end - line_start : 1;
+        return filename_ + ":" + std::to_string(line) + ":" + std::to_string(column) + ": ";
+    }
+
+    std::string ConfigBinder::Path() const
+    {
+        if (!stack_.empty() && stack_.back() == Frame::Args)
+        {
+            const std::string index = "[" + std::to_string(args_index_) + "]";
+            if (args_job_ == &root_job_)
+                return key_ + index;
+            return "jobs[" + std::to_string(config_.jobs.size()) + "]." + key_ + index;
+        }
+        if (stack_.empty() || stack_.back() == Frame::Root)
+            return key_;
+        if (stack_.back() == Frame::Jobs)
+            return "jobs[" + std::to_string(config_.jobs.size()) + "]";
+        return "jobs[" + std::to_string(config_.jobs.size()) + "]." + key_;
+    }
+
+    // The feed and credentials the updater is given with -f and -c.
+    void feed_from_arguments(JobConfig& job)
+    {
+        const std::vector<std::string>& args = job.updater_arguments;
+        for (std::size_t i = 0; i + 1 < args.size(); ++i)
+        {
+            if (args[i] == "-f" && job.feed.empty())
+                job.feed = args[i + 1];
+            else if (args[i] == "-c" && job.feed_credentials.empty())
+                job.feed_credentials = args[i + 1];
+        }
+    }
+}
+
+void JobConfig::BuildCommands()
+{
+    std::vector<std::string> args;
+    args.reserve(updater_arguments.size() + 2);
+    args.push_back(updater_filepath);
+    args.insert(args.end(), updater_arguments.begin(), updater_arguments.end());
+    check_command = CommandLine(args);
+    args.push_back("-u");
+    update_command = CommandLine(std::move(args));
+}
+
+const JobConfig* UpdaterConfig::FindJob(const std::string& name) const
+{
+    for (const auto& job : jobs)
+    {
+        if (job.name == name)
+            return &job;
+    }
+    return nullptr;
+}
+
+bool load_updater_config(const std::string& path, UpdaterConfig& config,
+                         std::string& error, std::vector<std::string>& warnings)
+{
+    namespace fs = std::experimental::filesystem;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        error = "Cannot open config file " + path;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    const std::string text = contents.str();
+
+    PositionBuffer buffer(text);
+    std::istream input(&buffer);
+    std::vector<std::string> errors;
+    ConfigBinder binder(fs::path(path).filename().string(), text, buffer, config, errors, warnings);
+    json::sax_parse(input, &binder);
+
+    if (errors.empty())
+    {
+        for (auto& job : config.jobs)
+        {
+            job.BuildCommands();
+            if (job.precheck && job.feed.empty())
+                feed_from_arguments(job);
+            if (job.precheck && job.feed.empty())
+            {
+                warnings.push_back(job.name + ": precheck needs \"feed\" or -f in \"args\", disabled");
+                job.precheck = false;
+            }
+        }
+        return true;
+    }
+    error.clear();
+    for (const auto& e : errors)
+    {
+        if (!error.empty())
+            error += '\n';
+        error += e;
+    }
+    return false;
+}
+
+bool validate_updater_config(const UpdaterConfig& config, std::string& error)
+{
+    namespace fs = std::experimental::filesystem;
+    if (config.jobs.empty())
+    {
+        error = "No jobs configured";
+        return false;
+    }
+
+    for (std::size_t i = 0; i < config.jobs.size(); ++i)
+    {
+        const JobConfig& job = config.jobs[i];
+        const fs::path p(job.updater_filepath);
+        if (!fs::exists(p))
+        {
+            error = job.name + ": executable path not exists";
+            return false;
+        }
+
+        if (job.schedule.interval < 5s)
+        {
+            error = job.name + ": interval is invalid";
+            return false;
+        }
+
+        // jobs are told apart by name across reloads
+        for (std::size_t j = 0; j < i; ++j)
+        {
+            if (config.jobs[j].name == job.name)
+            {
+                error = job.name + ": duplicate job name";
+                return false;
+            }
+        }
+    }
+
+    if (config.max_concurrent_jobs == 0)
+    {
+        error = "max_concurrent_jobs is invalid";
+        return false;
+    }
+
+    return true;
+}
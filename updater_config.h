@@ -0,0 +1,78 @@
+#ifndef UPDATER_CONFIG_H
+#define UPDATER_CONFIG_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "command_line.h"
+#include "log_shipper.h"
+#include "schedule_policy.h"
+
+// Contents of config_updater.json.
+// The service publishes one immutable instance at a time and swaps in a new
+// one when the file changes, so a loaded config is never modified.
+
+// One updater launched periodically, see "jobs".
+struct JobConfig
+{
+    std::string name;
+    std::string updater_filepath;
+    // "args", a string split like a command line or an array of strings
+    std::vector<std::string> updater_arguments;
+    SchedulePolicy::Options schedule;
+    // The updater with its arguments, to check for updates and then with -u
+    // to install them. Set by BuildCommands(), load_updater_config() does it.
+    CommandLine check_command;
+    CommandLine update_command;
+    // "precheck": the updater only runs when its feed changed, or when it
+    // hasn't for precheck_max_skip. "feed" and "feed_credentials" default
+    // to the -f and -c updater arguments.
+    bool precheck = false;
+    std::chrono::seconds precheck_max_skip{ 24 * 60 * 60 };
+    std::string feed;
+    std::string feed_credentials;
+
+    void BuildCommands();
+};
+
+// What to do when a job stops making progress, see "watchdog_action".
+enum class StallAction
+{
+    Log,
+    RestartJob,
+    FailService
+};
+
+struct UpdaterConfig
+{
+    std::string name;
+    std::vector<JobConfig> jobs;
+    std::size_t max_concurrent_jobs = 2;
+    StallAction stall_action = StallAction::Log;
+    // Added to every stage deadline on top of its expected duration.
+    std::chrono::seconds watchdog_grace{ 60 };
+    std::string user;
+    std::string pass;
+    std::string log_server;
+    // HTTP/2 without an upgrade to a plain http:// log_server that speaks
+    // it, "log_h2c".
+    bool log_h2c = false;
+    LogShipper::Options log_options;
+    uint64_t log_spool_max_bytes = 64 << 20;
+
+    // Null if there is no job called |name|.
+    const JobConfig* FindJob(const std::string& name) const;
+};
+
+// Reads |path| into |config|. Returns false with a description in |error|
+// if the file can't be read or parsed; settings that are merely suspicious
+// are reported in |warnings| and skipped.
+bool load_updater_config(const std::string& path, UpdaterConfig& config,
+                         std::string& error, std::vector<std::string>& warnings);
+
+// Checks what the service needs to run, e.g. that every updater exists.
+bool validate_updater_config(const UpdaterConfig& config, std::string& error);
+
+#endif
@@ -1,20 +1,29 @@
 #include "updater_service.h"
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <experimental/filesystem>
+#ifdef _WIN32
 #include <winsvc.h>
 #include <winnt.h>
 #include <tchar.h>
+#else
+#include <unistd.h>
+#endif
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include "host_clock.h"
 #include "json.hpp"
+#include <reproc++/capture.hpp>
 #include <reproc++/reproc.hpp>
-#include <reproc++/sink.hpp>
 #include <string>
-#include <sstream>
 #include <iostream>
-#include <curl/curl.h>
+#include <random>
 #include <thread>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #define EVENTLOG_MY_DEBUG 0x1000
 
@@ -29,21 +38,43 @@
 using namespace std::string_literals;
 using namespace std::chrono_literals;
 
+// How much of the updater's stdout and stderr is kept for error reports.
+const std::size_t kOutputTail = 16 * 1024;
+// Longest single wait for an updater, reproc::milliseconds wraps after
+// about 49 days.
+const std::chrono::hours kMaxUpdaterWait{ 24 };
+
+// Wall clock time of a scheduler time point, for log lines and reports.
+std::string format_due(JobScheduler::Clock::time_point due)
+{
+    using namespace std::chrono;
+    const auto delay = duration_cast<system_clock::duration>(due - JobScheduler::Clock::now());
+    char buf[kTimestampSize];
+    std::size_t buf_size = format_timestamp(buf, system_clock::now() + delay);
+    return std::string{ buf, buf_size };
+}
+
+// Upload sizes before and after gzip and the CPU time spent compressing.
+std::string compression_summary(const LogShipper::Stats& stats)
+{
+    char summary[128];
+    std::snprintf(summary, sizeof summary, "%llu -> %llu bytes (%.2fx), %lld us compressing per upload",
+                  static_cast<unsigned long long>(stats.raw_bytes), static_cast<unsigned long long>(stats.sent_bytes),
+                  stats.sent_bytes != 0 ? static_cast<double>(stats.raw_bytes) / stats.sent_bytes : 0.0,
+                  static_cast<long long>(stats.batches != 0 ? stats.compress_time.count() / stats.batches : 0));
+    return summary;
+}
+
 std::string executable_filepath()
 {
     char p[1024];
+#ifdef _WIN32
     DWORD real_size = GetModuleFileName(NULL, p, 1024);
     return std::string{ p, real_size };
-}
-
-std::string machine_name()
-{
-    char p[MAX_COMPUTERNAME_LENGTH + 1];
-    DWORD size = sizeof p;
-    BOOL result = GetComputerName(p, &size);
-    if (result)
-        return { p, size };
-    return {};
+#else
+    ssize_t real_size = readlink("/proc/self/exe", p, sizeof p);
+    return real_size > 0 ? std::string{ p, static_cast<std::size_t>(real_size) } : std::string{};
+#endif
 }
 
 UpdaterService::UpdaterService(int argc, char *argv[])
@@ -52,10 +83,7 @@ UpdaterService::UpdaterService(int argc, char *argv[])
         _T("Updater service"),
         SERVICE_DEMAND_START,
         SERVICE_ERROR_NORMAL,
-        SERVICE_ACCEPT_STOP)
-    , exit_(false)
-    , max_count_(0)
-    , interval_(0)
+        SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_PARAMCHANGE)
 {
 }
 
@@ -66,82 +94,510 @@ void UpdaterService::OnStart(DWORD argc, TCHAR* argv[])
 
     ProcessConfig();
 
-    if (!CheckArgs())
+    const auto config = Config();
+    std::string error;
+    if (!validate_updater_config(*config, error))
     {
+        Log(error, EVENTLOG_ERROR_TYPE);
         std::exit(-1);
     }
 
-    updater_arguments_ = updater_filepath_ + " " + updater_arguments_;
-    exit_ = false;
+    // for the log server and the feed prechecks
+    HttpClient::GlobalInit();
+    if (!config->log_server.empty())
+    {
+        log_options_ = config->log_options;
+        if (log_options_.gzip && !GzipWriter::Available())
+        {
+            WriteToEventLog("Built without zlib, log_gzip ignored", EVENTLOG_WARNING_TYPE);
+            log_options_.gzip = false;
+        }
+        if (config->log_h2c && !HttpClient::Http2Available())
+            WriteToEventLog("Built without HTTP/2, log_h2c ignored", EVENTLOG_WARNING_TYPE);
+        namespace fs = std::experimental::filesystem;
+        LogSpool::Options spool_options;
+        spool_options.directory = (fs::path{ executable_filepath() }.parent_path() / "log_spool").string();
+        spool_options.max_bytes = config->log_spool_max_bytes;
+        auto spool = std::make_unique<LogSpool>(spool_options);
+        if (!spool->Open())
+        {
+            WriteToEventLog("Cannot open log spool: " + spool_options.directory, EVENTLOG_WARNING_TYPE);
+            spool.reset();
+        }
+
+        ClefWriter clef_writer;
+        clef_writer.Init("(windows_updater: {machine_name}) {msg}", machine_name());
+        log_shipper_ = std::make_unique<LogShipper>(log_options_, clef_writer,
+            std::make_unique<LogTransport>(*this, config->log_server, log_options_, config->log_h2c), std::move(spool));
+        log_shipper_->Start();
+    }
+
+    namespace fs = std::experimental::filesystem;
+    const std::string feed_cache = (fs::path{ executable_filepath() }.parent_path() / "feed_cache.json").string();
+    if (!feed_cache_.Load(feed_cache, error))
+        Log(EVENTLOG_WARNING_TYPE, "Feed cache ignored: {error}", error);
+
+    stop_.Reset();
+    started_ = std::chrono::steady_clock::now();
     WriteToEventLog("Started", EVENTLOG_INFORMATION_TYPE);
-    thread_ = std::make_unique<std::thread>(std::bind(&UpdaterService::Work, this));
+    StartScheduler(*config, {});
+
+    if (!config_watcher_.Start(config_path_, [this] { ReloadConfig(); }))
+        Log(EVENTLOG_WARNING_TYPE, "Cannot watch {config_path}, changes need a restart: {error}", config_path_,
+            GetLastError());
 }
 
 void UpdaterService::OnStop()
 {
-    exit_ = true;
+    stop_.Set();
+    StopChildren();
     WriteToEventLog("Stopped", EVENTLOG_INFORMATION_TYPE);
-    if (thread_->joinable())
-        thread_->join();
+    // waits for a reload in progress, it won't start anything now
+    config_watcher_.Stop();
+    if (const auto scheduler = std::atomic_load(&scheduler_))
+        scheduler->Stop();
+    if (log_shipper_)
+    {
+        log_shipper_->Stop();
+        const LogShipper::Stats stats = log_shipper_->GetStats();
+        if (log_options_.gzip && stats.batches != 0)
+            WriteToEventLog("Log compression: " + compression_summary(stats), EVENTLOG_INFORMATION_TYPE);
+    }
+    {
+        // nothing runs any more
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        for (auto& job : jobs_)
+            job.probe->Close();
+    }
+    HttpClient::GlobalCleanup();
+}
+
+void UpdaterService::OnParamChange()
+{
+    config_watcher_.Trigger();
 }
 
-void UpdaterService::Work()
+// Settings only read while starting.
+bool same_log_settings(const UpdaterConfig& a, const UpdaterConfig& b)
 {
-    uint32_t current_count{ 0 };
-    while (!exit_)
+    const LogShipper::Options& x = a.log_options;
+    const LogShipper::Options& y = b.log_options;
+    return a.log_server.empty() == b.log_server.empty()
+        && a.log_spool_max_bytes == b.log_spool_max_bytes && a.log_h2c == b.log_h2c
+        && x.batch_size == y.batch_size && x.linger == y.linger && x.queue_capacity == y.queue_capacity
+        && x.max_in_flight == y.max_in_flight
+        && x.overflow == y.overflow && x.block_timeout == y.block_timeout
+        && std::equal(std::begin(x.rate_limit), std::end(x.rate_limit), std::begin(y.rate_limit))
+        && x.coalesce_window == y.coalesce_window && x.coalesce_capacity == y.coalesce_capacity
+        && x.retry_interval == y.retry_interval && x.gzip == y.gzip && x.gzip_level == y.gzip_level;
+}
+
+void UpdaterService::ReloadConfig()
+{
+    UpdaterConfig config;
+    std::string error;
+    std::vector<std::string> warnings;
+    const bool loaded = load_updater_config(config_path_, config, error, warnings)
+        && validate_updater_config(config, error);
+    for (const auto& warning : warnings)
+        Log(warning, EVENTLOG_WARNING_TYPE);
+    if (!loaded)
     {
-        WRITE_EVENT_DEBUG("New cycle");
-        std::this_thread::sleep_for(5s);
-        ++current_count;
-        if (current_count <= max_count_)
-            continue;
-        current_count = 0;
-        DWORD ret = -1;
-        if (!LaunchApp(std::string(), ret))
+        Log(EVENTLOG_ERROR_TYPE, "Config not reloaded, keeping the current one: {error}", error);
+        return;
+    }
+
+    const auto current = Config();
+    if (config.name != current->name || !same_log_settings(config, *current))
+    {
+        Log("Service name and log_* changes need a restart", EVENTLOG_WARNING_TYPE);
+        // the address of the log server is picked up by the next upload
+        std::string log_server = config.log_server.empty() == current->log_server.empty()
+            ? config.log_server : current->log_server;
+        config.name = current->name;
+        config.log_options = current->log_options;
+        config.log_spool_max_bytes = current->log_spool_max_bytes;
+        config.log_h2c = current->log_h2c;
+        config.log_server = std::move(log_server);
+    }
+
+    bool jobs_changed = config.jobs.size() != current->jobs.size()
+        || config.max_concurrent_jobs != current->max_concurrent_jobs;
+    for (const auto& job : config.jobs)
+        jobs_changed = jobs_changed || !current->FindJob(job.name);
+
+    std::shared_ptr<const UpdaterConfig> snapshot = std::make_shared<const UpdaterConfig>(std::move(config));
+    if (!jobs_changed)
+    {
+        // runs pick it up when they start, nothing is interrupted
+        std::atomic_store(&config_, snapshot);
+        Log("Config reloaded", EVENTLOG_INFORMATION_TYPE);
+        return;
+    }
+
+    // a new job set needs a new scheduler, jobs running now are let finish
+    // and every job that stays keeps its next run
+    const auto scheduler = std::atomic_load(&scheduler_);
+    scheduler->Stop();
+    std::atomic_store(&config_, snapshot);
+    if (stop_.IsSet())
+        return;
+    StartScheduler(*snapshot, scheduler->Status());
+    Log(EVENTLOG_INFORMATION_TYPE, "Config reloaded, now running {jobs} jobs", snapshot->jobs.size());
+}
+
+UpdaterService::Job& UpdaterService::FindOrAddJob(const JobConfig& config)
+{
+    const auto find = [&]() -> Job*
+    {
+        for (auto& job : jobs_)
         {
-            std::string g{ "Error while launching updater: " + std::to_string(GetLastError()) };
-            Log(g, EVENTLOG_ERROR_TYPE);
-            break;
+            if (job.name == config.name)
+                return &job;
         }
+        return nullptr;
+    };
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        if (Job* job = find())
+            return *job;
+    }
 
-        if (ret == 0)
+    // not under jobs_mutex_, the watchdog holds its own lock while OnStall()
+    // takes jobs_mutex_
+    Watchdog::Heartbeat* heartbeat = GetWatchdog().Register(config.name);
+    std::lock_guard<std::mutex> lock(jobs_mutex_);
+    if (Job* job = find())
+        return *job;
+    std::random_device seed;
+    jobs_.emplace_back(config.name);
+    Job& job = jobs_.back();
+    job.heartbeat = heartbeat;
+    job.policy = std::make_unique<SchedulePolicy>(config.schedule, seed());
+    job.probe = std::make_unique<FeedProbe>([this] { return stop_.IsSet(); });
+    return job;
+}
+
+void UpdaterService::StartScheduler(const UpdaterConfig& config, const std::vector<JobScheduler::JobStatus>& previous)
+{
+    auto scheduler = std::make_shared<JobScheduler>(config.max_concurrent_jobs);
+    for (const auto& job_config : config.jobs)
+    {
+        Job& job = FindOrAddJob(job_config);
+        JobScheduler::Job entry;
+        entry.name = job.name;
+        const auto it = std::find_if(previous.begin(), previous.end(),
+                                     [&](const JobScheduler::JobStatus& status) { return status.name == job.name; });
+        if (it != previous.end())
         {
-            WRITE_EVENT_DEBUG("No updates");
-            continue;
+            entry.first = it->next;
         }
-
-        if (ret == 3)
+        else
         {
-            std::string g{ "Updater returned error" };
-            Log(g, EVENTLOG_ERROR_TYPE);
-            continue;
+            entry.first = job.policy->First(JobScheduler::Clock::now());
+            LogNextRun(job, entry.first, 0);
         }
-
-        if (ret == 1)
+        entry.run = [this, &job]
         {
-            // we have updates
-            if (!LaunchApp(std::string("-u"), ret))
+            const auto config = Config();
+            const JobConfig* job_config = config->FindJob(job.name);
+            if (!job_config)
             {
-                std::string g{ "Error while launching updater with -u: " + std::to_string(GetLastError()) };
-                Log(g, EVENTLOG_ERROR_TYPE);
-                break;
+                // removed by a reload that is about to replace the scheduler
+                return JobScheduler::Clock::now() + std::chrono::hours{ 24 };
             }
+            job.policy->SetOptions(job_config->schedule);
+            const SchedulePolicy::Result result = RunJob(job, *config, *job_config);
+            ++job.counters.runs;
+            if (result == SchedulePolicy::Result::Updated)
+                ++job.counters.updates;
+            else if (result == SchedulePolicy::Result::Failed)
+                ++job.counters.failures;
+            const auto next = job.policy->Next(JobScheduler::Clock::now(), result);
+            LogNextRun(job, next, job.policy->Failures());
+            return next;
+        };
+        scheduler->Add(std::move(entry));
+    }
+    std::atomic_store(&scheduler_, scheduler);
+    scheduler->Start();
+}
 
-            if (ret == 0)
+void UpdaterService::StopChildren(const Job* job, bool kill)
+{
+    std::lock_guard<std::mutex> lock(children_mutex_);
+    for (auto& child : children_)
+    {
+        if (job && child.job != job)
+            continue;
+        if (child.exited || kill)
+            child.updater->kill_group();
+        else if (child.updater->terminate())
+            child.updater->kill();
+    }
+}
+
+void UpdaterService::OnStall(const Watchdog::Stall& stall)
+{
+    const auto overdue = std::chrono::duration_cast<std::chrono::milliseconds>(stall.overdue);
+    Log(EVENTLOG_ERROR_TYPE, "{heartbeat}: stalled in {stage}, {overdue_ms} ms past its deadline",
+        stall.heartbeat->Name(), stall.stage ? stall.stage : "unknown stage", overdue.count());
+
+    switch (Config()->stall_action)
+    {
+    case StallAction::Log:
+        break;
+    case StallAction::RestartJob:
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        for (const auto& job : jobs_)
+        {
+            // whatever it's stuck on, the updater or something it started
+            // that holds on to the output pipes
+            if (job.heartbeat == stall.heartbeat)
+                StopChildren(&job, true);
+        }
+        break;
+    }
+    case StallAction::FailService:
+        // OnStop() can be stopping it at the same time, Stop() allows that
+        if (log_shipper_)
+            log_shipper_->Stop();
+        ReportFailure(ERROR_SERVICE_SPECIFIC_ERROR);
+    }
+}
+
+ControlReply UpdaterService::OnControl(const ControlRequest& request)
+{
+    switch (request.command)
+    {
+    case ControlCommand::Status:
+        return { true, StatusReport() };
+
+    case ControlCommand::RunNow:
+        if (request.argument.empty())
+            return { false, "run-now needs a job name" };
+        if (!std::atomic_load(&scheduler_)->RunNow(request.argument))
+            return { false, request.argument + ": no such job or it is running already" };
+        Log(EVENTLOG_INFORMATION_TYPE, "{job}: run requested over the control channel", request.argument);
+        return { true, request.argument + ": queued" };
+
+    case ControlCommand::ReloadConfig:
+        // parsing and applying happen on the watcher thread
+        if (!config_watcher_.Trigger())
+            return { false, "config watcher is not running" };
+        return { true, "reload requested, the result goes to the service log" };
+
+    case ControlCommand::Stats:
+        return { true, StatsReport() };
+
+    case ControlCommand::FlushLogs:
+        // only asks, waiting on the sinks would hold up the control loop;
+        // local lines are written as soon as the log writer gets to them
+        if (log_shipper_)
+            log_shipper_->Flush();
+        return { true, "flush requested" };
+
+    default:
+        return ServiceBase::OnControl(request);
+    }
+}
+
+std::string UpdaterService::StatusReport() const
+{
+    std::string report;
+    for (const auto& status : std::atomic_load(&scheduler_)->Status())
+    {
+        report += status.name + ": ";
+        report += status.running ? "running" : "next run at " + format_due(status.next);
+        report += '\n';
+    }
+    return report;
+}
+
+std::string UpdaterService::StatsReport() const
+{
+    const auto config = Config();
+    std::string report;
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        for (const auto& job : jobs_)
+        {
+            if (!config->FindJob(job.name))
+                continue;
+            report += job.name + ": runs " + std::to_string(job.counters.runs.load())
+                + ", updates " + std::to_string(job.counters.updates.load())
+                + ", failures " + std::to_string(job.counters.failures.load());
+            const uint64_t saved = job.counters.launches_saved.load();
+            if (saved != 0 || config->FindJob(job.name)->precheck)
             {
-                WRITE_EVENT_DEBUG("Update successful");
+                // extrapolated from at least an hour so it doesn't jump
+                // around right after the start
+                const auto uptime = std::max<std::chrono::steady_clock::duration>(
+                    std::chrono::steady_clock::now() - started_, std::chrono::hours{ 1 });
+                const double per_day = saved * (std::chrono::hours{ 24 } / std::chrono::duration<double, std::chrono::hours::period>(uptime));
+                char rate[32];
+                std::snprintf(rate, sizeof rate, "%.1f", per_day);
+                report += ", launches saved " + std::to_string(saved) + " (" + rate + " per day)";
             }
+            report += '\n';
+        }
+    }
+    if (log_shipper_)
+    {
+        const LogShipper::Stats stats = log_shipper_->GetStats();
+        report += "log shipping: batches " + std::to_string(stats.batches)
+            + ", events " + std::to_string(stats.events)
+            + ", dropped " + std::to_string(stats.dropped)
+            + ", rate limited " + std::to_string(stats.rate_limited)
+            + ", blocked " + std::to_string(stats.blocked)
+            + ", spilled " + std::to_string(stats.spilled)
+            + ", coalesced " + std::to_string(stats.coalesced) + '\n';
+        report += "log compression: " + (log_options_.gzip ? compression_summary(stats)
+            : "off, " + std::to_string(stats.sent_bytes) + " bytes") + '\n';
+    }
+    report += "service log: dropped " + std::to_string(DroppedLogLines()) + '\n';
+    return report;
+}
+
+SchedulePolicy::Result UpdaterService::RunJob(Job& job, const UpdaterConfig& config, const JobConfig& job_config)
+{
+    using Result = SchedulePolicy::Result;
+    WRITE_EVENT_DEBUG("New cycle: " + job.name);
+    DWORD ret = -1;
+    // the heartbeat goes idle until the next run whichever way this returns
+    struct IdleOnExit
+    {
+        Watchdog::Heartbeat* heartbeat;
+        ~IdleOnExit() { heartbeat->Idle(); }
+    } idle{ job.heartbeat };
+
+    FeedFingerprint feed;
+    if (job_config.precheck && FeedUnchanged(job, config, job_config, feed))
+    {
+        ++job.counters.launches_saved;
+        return Result::NoUpdates;
+    }
+    if (stop_.IsSet())
+        return Result::NoUpdates;
+    // the feed is recorded once the updater has dealt with it
+    const auto record_feed = [&]
+    {
+        if (feed.Empty())
+            return;
+        FeedCache::Entry entry;
+        entry.fingerprint = feed;
+        entry.launched = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::string error;
+        if (!feed_cache_.Store(job.name, entry, error))
+            Log(EVENTLOG_WARNING_TYPE, "{job}: {error}", job.name, error);
+    };
+
+    if (!LaunchApp(job, config, job_config, job_config.check_command, ret))
+    {
+        if (stop_.IsSet())
+            return Result::NoUpdates;
+        Log(EVENTLOG_ERROR_TYPE, "{job}: error while launching updater: {error}", job.name, GetLastError());
+        return Result::Failed;
+    }
+
+    if (ret == 0)
+    {
+        WRITE_EVENT_DEBUG(job.name + ": no updates");
+        record_feed();
+        return Result::NoUpdates;
+    }
+
+    if (ret == 3)
+    {
+        Log(EVENTLOG_ERROR_TYPE, "{job}: updater returned error", job.name);
+        return Result::Failed;
+    }
+
+    if (ret == 1)
+    {
+        // we have updates
+        if (!LaunchApp(job, config, job_config, job_config.update_command, ret))
+        {
+            if (stop_.IsSet())
+                return Result::NoUpdates;
+            Log(EVENTLOG_ERROR_TYPE, "{job}: error while launching updater with -u: {error}", job.name,
+                GetLastError());
+            return Result::Failed;
         }
+
+        if (ret == 0)
+        {
+            WRITE_EVENT_DEBUG(job.name + ": update successful");
+            record_feed();
+        }
+        return Result::Updated;
     }
 
-    WRITE_EVENT_DEBUG("Exiting");
-    SetStatus(SERVICE_STOPPED);
+    return Result::NoUpdates;
 }
 
-void UpdaterService::ProcessArgs(int argc, char* argv[])
+bool UpdaterService::FeedUnchanged(const Job& job, const UpdaterConfig& config, const JobConfig& job_config,
+                                   FeedFingerprint& current)
+{
+    FeedCache::Entry entry;
+    const bool cached = feed_cache_.Find(job.name, entry);
+    job.heartbeat->Beat("check feed", FeedProbe::Timeout() + config.watchdog_grace);
+    std::string error;
+    const FeedProbe::Result result = job.probe->Check(job_config.feed, job_config.feed_credentials,
+                                                      entry.fingerprint, current, error);
+    if (result == FeedProbe::Result::Failed)
+    {
+        current = FeedFingerprint{};
+        if (!stop_.IsSet())
+            Log(EVENTLOG_WARNING_TYPE, "{job}: cannot check {feed}, running the updater: {error}", job.name,
+                job_config.feed, error);
+        return false;
+    }
+    if (result == FeedProbe::Result::Changed || !cached)
+    {
+        WRITE_EVENT_DEBUG(job.name + ": feed changed");
+        return false;
+    }
+
+    // the updater is run now and then anyway, it might have been interrupted
+    // or the installation changed under it
+    const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (now - entry.launched >= job_config.precheck_max_skip.count())
+    {
+        WRITE_EVENT_DEBUG(job.name + ": feed unchanged, running the updater after " + std::to_string(now - entry.launched) + " s");
+        return false;
+    }
+
+    // new validators for the same content save the download next time
+    if (current != entry.fingerprint)
+    {
+        entry.fingerprint = current;
+        if (!feed_cache_.Store(job.name, entry, error))
+            Log(EVENTLOG_WARNING_TYPE, "{job}: {error}", job.name, error);
+    }
+    WRITE_EVENT_DEBUG(job.name + ": feed unchanged, updater not launched");
+    return true;
+}
+
+void UpdaterService::LogNextRun(const Job& job, JobScheduler::Clock::time_point next, unsigned failures) const
+{
+    if (failures != 0)
+        Log(EVENTLOG_MY_DEBUG, "{job}: next run at {next_run}, backing off after {failures} failures", job.name,
+            format_due(next), failures);
+    else
+        Log(EVENTLOG_MY_DEBUG, "{job}: next run at {next_run}", job.name, format_due(next));
+}
+
+void UpdaterService::ProcessArgs(int argc, char* argv[], UpdaterConfig& config)
 {
     //skipping executable name
     //parsing service name first
+    if (config.jobs.empty())
+        config.jobs.emplace_back();
+    JobConfig& job = config.jobs.front();
     for (int i = 1; i < argc; ++i)
     {
         std::string t{ argv[i] };
@@ -174,8 +630,8 @@ void UpdaterService::ProcessArgs(int argc, char* argv[])
                 return;
             }
 
-            updater_filepath_ = argv[i + 1];
-            std::string g{ "Updater filepath: " + updater_filepath_ };
+            job.updater_filepath = argv[i + 1];
+            std::string g{ "Updater filepath: " + job.updater_filepath };
             WRITE_EVENT_DEBUG(g.c_str());
             DEBUG_LOG(g);
         }
@@ -188,8 +644,14 @@ void UpdaterService::ProcessArgs(int argc, char* argv[])
                 return;
             }
 
-            updater_arguments_ = argv[i + 1];
-            std::string g{ "Updater args: " + updater_arguments_ };
+            std::string error;
+            job.updater_arguments.clear();
+            if (!split_arguments(argv[i + 1], job.updater_arguments, error))
+            {
+                Log(EVENTLOG_ERROR_TYPE, "Wrong updater arguments: {error}", error);
+                return;
+            }
+            std::string g{ "Updater args: " + std::string(argv[i + 1]) };
             WRITE_EVENT_DEBUG(g.c_str());
             DEBUG_LOG(g);
         }
@@ -204,11 +666,10 @@ void UpdaterService::ProcessArgs(int argc, char* argv[])
 
             t = argv[i + 1];
             unsigned long tmp = std::strtoul(t.c_str(), nullptr, 10);
-            interval_ = std::chrono::seconds{ tmp };
-            if (interval_ < 5s)
-                interval_ = 5s;
-            max_count_ = interval_ / 5s;
-            std::string g{ "Interval: " + std::to_string(interval_.count()) };
+            job.schedule.interval = std::chrono::seconds{ tmp };
+            if (job.schedule.interval < 5s)
+                job.schedule.interval = 5s;
+            std::string g{ "Interval: " + std::to_string(job.schedule.interval.count()) };
             WRITE_EVENT_DEBUG(g.c_str());
             DEBUG_LOG(g);
         }
@@ -221,8 +682,8 @@ void UpdaterService::ProcessArgs(int argc, char* argv[])
                 return;
             }
 
-            user_runas_ = argv[i + 1];
-            std::string g{ "User: " + user_runas_ };
+            config.user = argv[i + 1];
+            std::string g{ "User: " + config.user };
             WRITE_EVENT_DEBUG(g.c_str());
             DEBUG_LOG(g);
         }
@@ -235,67 +696,51 @@ void UpdaterService::ProcessArgs(int argc, char* argv[])
                 return;
             }
 
-            user_pass_ = argv[i + 1];
-            std::string g{ "User pass: " + user_pass_ };
+            config.pass = argv[i + 1];
+            std::string g{ "User pass: " + config.pass };
             WRITE_EVENT_DEBUG(g.c_str());
             DEBUG_LOG(g);
         }
     }
+    job.BuildCommands();
 }
 
 void UpdaterService::ProcessConfig()
 {
-    using nlohmann::json;
     namespace fs = std::experimental::filesystem;
     std::string exec = executable_filepath();
     if (exec.empty())
     {
-        Log(std::string{ "Cannot get executable path: " + std::to_string(GetLastError()) }, EVENTLOG_ERROR_TYPE);
+        Log(EVENTLOG_ERROR_TYPE, "Cannot get executable path: {error}", GetLastError());
         std::exit(-1);
     }
 
     fs::path config_path{ exec };
     config_path = config_path.parent_path() / "config_updater.json";
+    config_path_ = config_path.string();
 
     if (!exists(config_path))
     {
-        Log(std::string{ "config_updater.json file dont exist, creating default: " + config_path.string() }, EVENTLOG_WARNING_TYPE);
+        Log(EVENTLOG_WARNING_TYPE, "config_updater.json file dont exist, creating default: {config_path}",
+            config_path.string());
         CreateDefaultConfig("config_updater.json");
     }
 
-    json options;
-    std::fstream file(config_path.string(), std::ios::in);
-    if (!file.is_open())
-    {
-        Log(std::string{ "Cannot open config file" + config_path.string() }, EVENTLOG_ERROR_TYPE);
-        std::exit(-1);
-    }
-
-    try
+    auto config = std::make_shared<UpdaterConfig>();
+    std::string error;
+    std::vector<std::string> warnings;
+    const bool loaded = load_updater_config(config_path_, *config, error, warnings);
+    for (const auto& warning : warnings)
+        Log(warning, EVENTLOG_WARNING_TYPE);
+    if (!loaded)
     {
-        file >> options;
-        std::string name = options["name"].get<std::string>();
-        SetName(_T(name.c_str()));
-        updater_filepath_ = options["updater"].get<std::string>();
-        updater_arguments_ = options["args"].get<std::string>();
-        auto temp_interval = options["interval"].get<unsigned long>();
-        interval_ = std::chrono::seconds{ temp_interval };
-        if (interval_ < 5s)
-            interval_ = 5s;
-        max_count_ = interval_ / 5s;
-        if (options.count("user") != 0)
-            user_runas_ = options["user"].get<std::string>();
-        if (options.count("pass") != 0)
-            user_pass_ = options["pass"].get<std::string>();
-        if (options.count("log_server") != 0)
-            logger_server_ = options["log_server"].get<std::string>();
-    }
-    catch (json::exception &e)
-    {
-        Log(std::string{ "Caught exception: " + std::string{ e.what() } }, EVENTLOG_ERROR_TYPE);
+        Log(error, EVENTLOG_ERROR_TYPE);
         SetStatus(SERVICE_STOPPED);
         std::exit(-1);
     }
+
+    SetName(_T(config->name.c_str()));
+    std::atomic_store(&config_, std::shared_ptr<const UpdaterConfig>(std::move(config)));
 }
 
 void UpdaterService::CreateDefaultConfig(const std::string& filename)
@@ -307,10 +752,30 @@ void UpdaterService::CreateDefaultConfig(const std::string& filename)
     config = config.parent_path() / filename;
     json options;
     options["name"] = "AgentUpdater";
-    options["updater"] = "C:\\miner\\NAppUpdate.Updater.Standalone.exe";
-    options["args"] = "-f ftp://10.7.5.32/distro/miner/feed.xml -c read-ftp:Aa123456";
-    options["interval"] = 300;
+    json job;
+    job["name"] = "miner";
+    job["updater"] = "C:\\miner\\NAppUpdate.Updater.Standalone.exe";
+    job["args"] = "-f ftp://10.7.5.32/distro/miner/feed.xml -c read-ftp:Aa123456";
+    job["interval"] = 300;
+    job["splay"] = 300;
+    job["jitter"] = 30;
+    job["max_backoff"] = 3600;
+    job["after_update_interval"] = 60;
+    options["jobs"] = json::array({ job });
+    options["max_concurrent_jobs"] = 2;
+    options["watchdog_action"] = "restart_job";
+    options["watchdog_grace_s"] = 60;
     options["log_server"] = "http://gilmutdinov.ru:9001/api/events/raw";
+    options["log_batch_size"] = 50;
+    options["log_linger_ms"] = 1000;
+    options["log_queue_size"] = 1000;
+    options["log_max_in_flight"] = 4;
+    options["log_overflow"] = "drop_debug_first";
+    options["log_coalesce_s"] = 3600;
+    options["log_retry_s"] = 30;
+    options["log_spool_max_mb"] = 64;
+    options["log_gzip"] = false;
+    options["log_h2c"] = false;
 
     std::fstream file{ config.c_str(), std::ios::out };
     try
@@ -318,154 +783,165 @@ void UpdaterService::CreateDefaultConfig(const std::string& filename)
         file << options;
     } catch (std::exception &e)
     {
-        Log(std::string{ "Caught exception: " + std::string{ e.what() } }, EVENTLOG_ERROR_TYPE);
+        Log(EVENTLOG_ERROR_TYPE, "Caught exception: {exception}", e.what());
         SetStatus(SERVICE_STOPPED);
         std::exit(-1);
     }
 }
 
-void UpdaterService::Log(const std::string& message, WORD level, bool wait) const
+void UpdaterService::Log(const LogRecord& record, WORD level) const
 {
     if (level == EVENTLOG_MY_DEBUG)
-        WRITE_EVENT_DEBUG(message.c_str());
+        WRITE_EVENT_DEBUG(record);
     else
-        WriteToEventLog(message, level);
+        WriteToEventLog(record, level);
 
-    WRITE_EVENT_DEBUG("log server addr");
-    WRITE_EVENT_DEBUG(logger_server_);
     //trying to post log to seq
-    if (!logger_server_.empty())
-    {
-        using nlohmann::json;
-
-        std::string seqLevel;
-        switch (level)
-        {
-        case EVENTLOG_ERROR_TYPE: seqLevel = "Error"; break;
-        case EVENTLOG_WARNING_TYPE: seqLevel = "Warning"; break;
-        case EVENTLOG_INFORMATION_TYPE: seqLevel = "Information"; break;
-        case EVENTLOG_MY_DEBUG: seqLevel = "Debug"; break;
-        default:
-            return;
-        }
-
-        std::time_t timestamp = std::time(nullptr);
-        char buf[64] = { 0 };
-        strftime(buf, 32, "%Y-%m-%dT%T.00000%z", localtime(&timestamp));
-        json body;
-        body["Level"] = seqLevel;
-        body["Timestamp"] = buf;
-        body["MessageTemplate"] = "(windows_updater: {machine_name}) {msg}";
-        json prop;
-        prop["machine_name"] = machine_name();
-        prop["msg"] = message;
-        body["Properties"] = prop;
-        json wrapper;
-        wrapper["Events"] = json::array({ body });
-
-        WRITE_EVENT_DEBUG("wrapper json");
-        WRITE_EVENT_DEBUG(wrapper.dump().c_str());
-
-        // thougth about async call but wont do it now
-        const auto log_send = [&](std::string json, std::string srv)
-        {
-            CURL *curl;
-            CURLcode res;
-            curl_global_init(CURL_GLOBAL_ALL);
-            curl = curl_easy_init();
-            if (curl)
-            {
-                WRITE_EVENT_DEBUG("curl initialized");
-                curl_easy_setopt(curl, CURLOPT_URL, srv.c_str());
-                curl_easy_setopt(curl, CURLOPT_POST, 1);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, json.size());
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json.c_str());
-
-                struct curl_slist *hs = nullptr;
-                hs = curl_slist_append(hs, "Content-Type: application/json");
-                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, hs);
-                res = curl_easy_perform(curl);
-                if (res != CURLE_OK)
-                {
-                    std::string err = curl_easy_strerror(res);
-                    WriteToEventLog("Log send error: "s + err, EVENTLOG_ERROR_TYPE);
-                }
-                curl_easy_cleanup(curl);
-            }
-            curl_global_cleanup();
-        };
+    if (!log_shipper_)
+        return;
 
-        std::thread perform_log_send{ log_send, wrapper.dump(-1, ' ', true), logger_server_ };
-        if (wait)
-            perform_log_send.join();
-        else
-            perform_log_send.detach();
+    ClefWriter::Level seqLevel;
+    switch (level)
+    {
+    case EVENTLOG_ERROR_TYPE: seqLevel = ClefWriter::Level::Error; break;
+    case EVENTLOG_WARNING_TYPE: seqLevel = ClefWriter::Level::Warning; break;
+    case EVENTLOG_INFORMATION_TYPE: seqLevel = ClefWriter::Level::Information; break;
+    case EVENTLOG_MY_DEBUG: seqLevel = ClefWriter::Level::Debug; break;
+    default:
+        return;
     }
+
+    // serialized on the shipper thread
+    log_shipper_->Enqueue(seqLevel, record);
 }
 
-bool UpdaterService::CheckArgs() const
+// Follows log_server across reloads, the other log settings need a restart.
+class UpdaterService::LogTransport : public LogShipper::Transport
 {
-    namespace fs = std::experimental::filesystem;
-    const fs::path p(updater_filepath_);
-    if (!fs::exists(p))
+public:
+    LogTransport(const UpdaterService& service, const std::string& url, const LogShipper::Options& options,
+                 bool h2c)
+        : service_(service)
+        , client_(url, options.gzip ? "gzip" : "", options.max_in_flight, h2c)
     {
-        Log("Executable path not exists", EVENTLOG_ERROR_TYPE);
-        return false;
     }
 
-    if (max_count_ == 0)
+    std::size_t Capacity() const override { return client_.Capacity(); }
+
+    bool Start(const std::string& body, uint64_t id) override
     {
-        Log("Interval is invalid", EVENTLOG_ERROR_TYPE);
+        const auto config = service_.Config();
+        if (config->log_server != client_.Url())
+            client_.SetUrl(config->log_server);
+
+        std::string error;
+        if (client_.Start(body, id, &error))
+            return true;
+        service_.WriteToEventLog("Log send error: " + error, EVENTLOG_ERROR_TYPE);
         return false;
     }
 
-    return true;
-}
+    void Poll(std::chrono::milliseconds timeout, std::vector<Result>& done) override
+    {
+        completions_.clear();
+        client_.Poll(timeout, completions_);
+        for (const auto& completion : completions_)
+        {
+            if (!completion.ok)
+                service_.WriteToEventLog("Log send error: " + completion.error, EVENTLOG_ERROR_TYPE);
+            done.push_back({ completion.id, completion.ok });
+        }
+    }
 
-bool UpdaterService::LaunchApp(const std::string& additional_args, DWORD& ret)
+private:
+    const UpdaterService& service_;
+    HttpClient client_;
+    std::vector<HttpClient::Completion> completions_;
+};
+
+bool UpdaterService::LaunchApp(const Job& job, const UpdaterConfig& config, const JobConfig& job_config,
+                               const CommandLine& command, DWORD& ret)
 {
     reproc::process updater;
-    std::string args{ updater_arguments_ + " " + additional_args };
-    std::vector<std::string> a;
-    std::stringstream str;
-    str << args;
-    std::string tmp;
-    while (str >> tmp)
-        a.push_back(tmp);
-    std::error_code err = updater.start(a);
-
-    std::chrono::milliseconds time_chunk{ 5s };
-    uint64_t count = 0;
+    job.heartbeat->Beat("start updater", config.watchdog_grace);
+    // the argv was built when the config was loaded
+    std::error_code err = updater.start(command.Argc(), command.Argv());
+    if (err)
+        return false;
+
+    // read both streams while the updater runs so it never blocks on a full pipe
+    reproc::capture output{ updater, kOutputTail, kOutputTail };
+
+    {
+        std::lock_guard<std::mutex> lock(children_mutex_);
+        children_.push_back({ &job, &updater, false });
+    }
+    // OnStop() might have run before the updater was registered
+    if (stop_.IsSet())
+        StopChildren();
+
+    // the updater gets one interval to finish, OnStop() interrupts the wait
+    WRITE_EVENT_DEBUG("Waiting for updater");
+    job.heartbeat->Beat("wait for updater", job_config.schedule.interval + config.watchdog_grace);
     unsigned exit_status = 0;
-    while (count < max_count_)
+    const auto deadline = std::chrono::steady_clock::now() + job_config.schedule.interval;
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(job_config.schedule.interval);
+    do
     {
-        WRITE_EVENT_DEBUG("Waiting cycle");
-        ++count;
-        err = updater.wait(time_chunk, &exit_status);
-        if (exit_)
-        {
-            err = updater.terminate();
-            if (err)
-                updater.kill();
-            return false;
-        }
+        err = updater.wait(std::chrono::duration_cast<reproc::milliseconds>(std::min<std::chrono::milliseconds>(
+                               left, kMaxUpdaterWait)), &exit_status);
+        left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    } while (err == reproc::errc::wait_timeout && left.count() > 0);
+    const bool timed_out = err == reproc::errc::wait_timeout;
+    if (timed_out || stop_.IsSet())
+    {
+        // abandoned along with everything it started, which would keep the
+        // output pipes open otherwise
+        updater.kill_group();
+        if (timed_out)
+            updater.wait(reproc::infinite, nullptr);
+    }
 
-        if (err == reproc::errc::wait_timeout)
-            continue;
+    // the capture threads only finish once every process holding the output
+    // pipes is gone, the updater stays in children_ until then so a stall
+    // here can still be ended by killing them
+    {
+        std::lock_guard<std::mutex> lock(children_mutex_);
+        std::find_if(children_.begin(), children_.end(), [&](const Child& child) {
+            return child.updater == &updater;
+        })->exited = true;
+    }
+    job.heartbeat->Beat("collect output", config.watchdog_grace);
+    const std::error_code ec = output.join();
+    {
+        std::lock_guard<std::mutex> lock(children_mutex_);
+        children_.erase(std::find_if(children_.begin(), children_.end(), [&](const Child& child) {
+            return child.updater == &updater;
+        }));
+    }
+
+    if (stop_.IsSet())
+        return false;
+
+    if (timed_out)
+    {
+        Log(EVENTLOG_ERROR_TYPE, "{job}: updater timed out", job.name);
+        return false;
+    }
 
-        ret = exit_status;
-        if (err || ret == 3)
+    ret = exit_status;
+    if (err || ret == 3)
+    {
+        if (err)
+            Log(EVENTLOG_ERROR_TYPE, "Error value: {error}", err.value());
+        if (!ec)
         {
-            if (err)
-                Log(std::string{ "Error value: " + std::to_string(err.value()) }, EVENTLOG_ERROR_TYPE);
-            std::string sink_string;
-            std::error_code ec = updater.drain(reproc::stream::out, reproc::string_sink(sink_string));
-            if (!ec)
-                Log(std::string{ "Program output: " + sink_string }, EVENTLOG_ERROR_TYPE);
-            else
-                Log(std::string{ "Cannot print program output: " + std::to_string(ec.value()) }, EVENTLOG_ERROR_TYPE);
+            Log(EVENTLOG_ERROR_TYPE, "Program output: {output}", output.out().str());
+            if (output.err().total() != 0)
+                Log(EVENTLOG_ERROR_TYPE, "Program error output: {output}", output.err().str());
         }
-        break;
+        else
+            Log(EVENTLOG_ERROR_TYPE, "Cannot print program output: {error}", ec.value());
     }
 
     WRITE_EVENT_DEBUG(std::string{ "Error value: " + std::to_string(err.value()) }.c_str());
@@ -2,10 +2,31 @@
 #define UPDATER_SERVICE_H
 
 #include "service_base.h"
-#include <thread>
+#include "clef_writer.h"
+#include "config_watcher.h"
+#include "feed_cache.h"
+#include "feed_probe.h"
+#include "http_client.h"
+#include "job_scheduler.h"
+#include "log_record.h"
+#include "log_shipper.h"
+#include "schedule_policy.h"
+#include "stop_event.h"
+#include "updater_config.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 #include <chrono>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace reproc
+{
+class process;
+}
 
 class UpdaterService : public ServiceBase
 {
@@ -20,27 +41,104 @@ public:
     virtual ~UpdaterService() = default;
     
 private:
+    // Run outcomes of one job, reported by "service_ctl <name> stats".
+    struct JobCounters
+    {
+        std::atomic<uint64_t> runs{ 0 };
+        std::atomic<uint64_t> updates{ 0 };
+        std::atomic<uint64_t> failures{ 0 };
+        // Runs that found the feed unchanged and didn't launch the updater.
+        std::atomic<uint64_t> launches_saved{ 0 };
+    };
+
+    // Runtime state of one of the configured jobs, kept by name across
+    // config reloads. What to run is looked up in the config every run.
+    struct Job
+    {
+        explicit Job(const std::string& job_name) : name(job_name) {}
+
+        const std::string name;
+        Watchdog::Heartbeat* heartbeat = nullptr;
+        // Only used by the job's runs, never concurrently.
+        std::unique_ptr<SchedulePolicy> policy;
+        std::unique_ptr<FeedProbe> probe;
+        JobCounters counters;
+    };
 
-    void Work();
+    std::shared_ptr<const UpdaterConfig> Config() const { return std::atomic_load(&config_); }
+    // Runs on the config watcher thread.
+    void ReloadConfig();
+    Job& FindOrAddJob(const JobConfig& config);
+    // Schedules the jobs of |config|. Jobs found in |previous| keep their
+    // next run, new ones start with their splay.
+    void StartScheduler(const UpdaterConfig& config, const std::vector<JobScheduler::JobStatus>& previous);
+
+    SchedulePolicy::Result RunJob(Job& job, const UpdaterConfig& config, const JobConfig& job_config);
+    // True if the feed of a precheck job is as the updater last saw it, so
+    // it needn't run. Otherwise |current| is what to record once the
+    // updater ran, empty if the feed couldn't be checked.
+    bool FeedUnchanged(const Job& job, const UpdaterConfig& config, const JobConfig& job_config,
+                       FeedFingerprint& current);
+    void LogNextRun(const Job& job, JobScheduler::Clock::time_point next, unsigned failures) const;
+    // Ends the waits in LaunchApp() for the updaters of |job|, or of every
+    // job if null. Running updaters are terminated, or with |kill| killed
+    // together with the processes they started. Processes left behind by an
+    // updater that exited, which keep its output pipes open, are always
+    // killed.
+    void StopChildren(const Job* job = nullptr, bool kill = false);
     void OnStart(DWORD argc, TCHAR* argv[]) override;
     void OnStop() override;
+    void OnParamChange() override;
+    void OnStall(const Watchdog::Stall& stall) override;
+    ControlReply OnControl(const ControlRequest& request) override;
+    std::string StatusReport() const;
+    std::string StatsReport() const;
     
-    void ProcessArgs(int argc, char *argv[]);
+    void ProcessArgs(int argc, char *argv[], UpdaterConfig& config);
     void ProcessConfig();
-    bool CheckArgs() const;
-    bool LaunchApp(const std::string& additional_args, DWORD &ret);
+    bool LaunchApp(const Job& job, const UpdaterConfig& config, const JobConfig& job_config,
+                   const CommandLine& command, DWORD &ret);
     void CreateDefaultConfig(const std::string& config);
-    void Log(const std::string& message, WORD level, bool wait = true) const;
-
-    std::unique_ptr<std::thread> thread_;
-    bool exit_;
-    std::string updater_filepath_;
-    std::string updater_arguments_;
-    std::string user_runas_;
-    std::string user_pass_;
-    std::string logger_server_;
-    uint64_t max_count_;
-    std::chrono::seconds interval_;
+    // Logs |message_template| with its holes bound to |args|, formatted on
+    // the log threads rather than here, see LogRecord.
+    template <typename... Args>
+    void Log(WORD level, const char* message_template, const Args&... args) const
+    {
+        Log(LogRecord(message_template, args...), level);
+    }
+    void Log(const LogRecord& record, WORD level) const;
+    void Log(const std::string& message, WORD level) const { Log(LogRecord("{msg}", message), level); }
+
+    // Posts log batches to log_server, see updater_service.cpp.
+    class LogTransport;
+
+    std::string config_path_;
+    // Replaced as a whole on reload and never modified in place. Always
+    // read through Config() so readers never wait for a reload.
+    std::shared_ptr<const UpdaterConfig> config_;
+    ConfigWatcher config_watcher_;
+    // Jobs are only ever added, so references to them stay valid.
+    mutable std::mutex jobs_mutex_;
+    std::deque<Job> jobs_;
+    // Replaced when a reload adds or removes jobs, std::atomic_load it.
+    std::shared_ptr<JobScheduler> scheduler_;
+    StopEvent stop_;
+    std::chrono::steady_clock::time_point started_;
+    FeedCache feed_cache_;
+    struct Child
+    {
+        const Job* job;
+        reproc::process* updater;
+        // Waited for, its output is still being collected.
+        bool exited;
+    };
+    // Updaters from start until their output is collected, guarded by
+    // children_mutex_.
+    std::mutex children_mutex_;
+    std::vector<Child> children_;
+    // Log settings in effect, they only change with a restart.
+    LogShipper::Options log_options_;
+    std::unique_ptr<LogShipper> log_shipper_;
 };
 
 #endif
@@ -0,0 +1,69 @@
+#include "watchdog.h"
+
+#include <vector>
+
+Watchdog::~Watchdog()
+{
+    Stop();
+}
+
+Watchdog::Heartbeat* Watchdog::Register(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    heartbeats_.emplace_back(name);
+    return &heartbeats_.back();
+}
+
+void Watchdog::Start(Clock::duration interval, StallHandler handler)
+{
+    if (thread_.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (heartbeats_.empty())
+            return;
+    }
+    handler_ = std::move(handler);
+    stop_.Reset();
+    thread_ = std::thread(&Watchdog::Monitor, this, interval);
+}
+
+void Watchdog::Stop()
+{
+    stop_.Set();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void Watchdog::Monitor(Clock::duration interval)
+{
+    std::vector<Stall> stalls;
+    while (!stop_.WaitFor(interval))
+    {
+        const Clock::rep now = Clock::now().time_since_epoch().count();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& heartbeat : heartbeats_)
+            {
+                const Clock::rep deadline = heartbeat.deadline_.load(std::memory_order_acquire);
+                if (deadline == 0 || now <= deadline)
+                    continue;
+
+                // one report per stall, a new beat re-arms it
+                const uint64_t beats = heartbeat.beats_.load(std::memory_order_relaxed);
+                if (beats == heartbeat.reported_)
+                    continue;
+                heartbeat.reported_ = beats;
+
+                stalls.push_back({ &heartbeat, heartbeat.stage_.load(std::memory_order_relaxed),
+                                   Clock::duration{ now - deadline } });
+            }
+        }
+
+        // unlocked, the handler may take locks that are held while calling
+        // Register()
+        for (const auto& stall : stalls)
+            handler_(stall);
+        stalls.clear();
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "stop_event.h"
+
+// Detects worker threads that stopped making progress.
+// Every worker registers a Heartbeat and beats it with the stage it enters
+// and how long that stage may take. A monitor thread periodically looks
+// for heartbeats past their deadline and reports each stall once.
+class Watchdog
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Heartbeat
+    {
+    public:
+        explicit Heartbeat(const std::string& name) : name_(name) {}
+
+        // Lock free, plain stores and no read-modify-write since only the
+        // owning thread beats. |stage| must be a string literal or otherwise
+        // outlive the heartbeat.
+        void Beat(const char* stage, Clock::duration timeout)
+        {
+            stage_.store(stage, std::memory_order_relaxed);
+            beats_.store(beats_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            deadline_.store((Clock::now() + timeout).time_since_epoch().count(), std::memory_order_release);
+        }
+
+        // Not monitored until the next Beat(), e.g. while waiting for work.
+        void Idle() { deadline_.store(0, std::memory_order_release); }
+
+        const std::string& Name() const { return name_; }
+
+    private:
+        friend class Watchdog;
+
+        const std::string name_;
+        std::atomic<const char*> stage_{ nullptr };
+        std::atomic<uint64_t> beats_{ 0 };
+        std::atomic<Clock::rep> deadline_{ 0 };
+        // Beat count of the last reported stall, monitor thread only.
+        uint64_t reported_ = 0;
+    };
+
+    struct Stall
+    {
+        const Heartbeat* heartbeat;
+        const char* stage;
+        Clock::duration overdue;
+    };
+
+    using StallHandler = std::function<void(const Stall&)>;
+
+    Watchdog() = default;
+    ~Watchdog();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+    // The heartbeat lives as long as the watchdog. Starts out idle.
+    Heartbeat* Register(const std::string& name);
+
+    // Checks every |interval|, |handler| runs on the monitor thread without
+    // the watchdog's lock held. Does nothing if no heartbeat was registered.
+    void Start(Clock::duration interval, StallHandler handler);
+    void Stop();
+
+private:
+    void Monitor(Clock::duration interval);
+
+    std::mutex mutex_;
+    std::deque<Heartbeat> heartbeats_;
+    StallHandler handler_;
+    StopEvent stop_;
+    std::thread thread_;
+};
+
+#endif